@@ -0,0 +1,558 @@
+#include "archive.h"
+#include "early_hints.h"
+#include "webpage_handler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr char ARCHIVE_MAGIC[8] = {'J', 'E', 'L', 'L', 'A', 'P', 'K', '1'};
+    constexpr uint32_t ARCHIVE_VERSION = 1;
+    constexpr uint32_t ARCHIVE_BYTE_ORDER = 0x01020304;
+    constexpr uint64_t ARCHIVE_PAGE_SIZE = 4096;
+    constexpr uint32_t KEYS_PER_BUCKET = 4;
+    constexpr uint32_t MAX_DISPLACEMENT = 1u << 20;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t seed;
+        uint32_t bucket_count;
+        uint32_t entry_count;
+        uint64_t displacement_offset;
+        uint64_t record_offset;
+        uint64_t file_size;
+    };
+
+    struct Record {
+        uint64_t hash;
+        uint64_t path_offset;
+        uint64_t path_length;
+        uint64_t headers_offset;
+        uint64_t headers_length;
+        uint64_t body_offset;
+        uint64_t body_length;
+        uint64_t gzip_headers_offset;
+        uint64_t gzip_headers_length;
+        uint64_t gzip_body_offset;
+        uint64_t gzip_body_length;
+    };
+
+    static_assert(std::is_trivially_copyable_v<FileHeader> && std::is_trivially_copyable_v<Record>);
+
+    uint64_t mix64(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    uint64_t path_hash(const std::string_view path, const uint64_t seed) {
+        uint64_t hash = 14695981039346656037ULL ^ seed;
+        for (const char c : path) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        return mix64(hash);
+    }
+
+    uint32_t bucket_of(const uint64_t hash, const uint32_t bucket_count) {
+        return static_cast<uint32_t>((hash >> 32) % bucket_count);
+    }
+
+    uint32_t slot_of(const uint64_t hash, const uint32_t displacement, const uint32_t entry_count) {
+        return static_cast<uint32_t>(mix64(hash + displacement * 0x9e3779b97f4a7c15ULL) % entry_count);
+    }
+
+    uint64_t align_up(const uint64_t value, const uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    bool in_bounds(const uint64_t offset, const uint64_t length, const uint64_t size) {
+        return offset <= size && length <= size - offset;
+    }
+
+    // Hash-and-displace: keys are grouped into buckets, and buckets are placed
+    // largest first by searching for a displacement that sends all of their
+    // keys to free slots. Returns false when no displacement fits, in which
+    // case the caller retries with a different seed.
+    bool build_perfect_hash(const std::vector<uint64_t>& hashes, const uint32_t bucket_count,
+                            std::vector<uint32_t>& displacements, std::vector<uint32_t>& slot_of_key) {
+        const auto entry_count = static_cast<uint32_t>(hashes.size());
+
+        std::vector<std::vector<uint32_t>> buckets(bucket_count);
+        for (uint32_t i = 0; i < entry_count; ++i) {
+            buckets[bucket_of(hashes[i], bucket_count)].push_back(i);
+        }
+
+        std::vector<uint32_t> order(bucket_count);
+        for (uint32_t i = 0; i < bucket_count; ++i) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&buckets](const uint32_t a, const uint32_t b) {
+            return buckets[a].size() > buckets[b].size();
+        });
+
+        displacements.assign(bucket_count, 0);
+        slot_of_key.assign(entry_count, 0);
+        std::vector<bool> occupied(entry_count, false);
+        std::vector<uint32_t> candidate;
+
+        for (const uint32_t bucket : order) {
+            if (buckets[bucket].empty()) {
+                break;
+            }
+
+            bool placed = false;
+            for (uint32_t displacement = 0; displacement < MAX_DISPLACEMENT && !placed; ++displacement) {
+                candidate.clear();
+                placed = true;
+
+                for (const uint32_t key : buckets[bucket]) {
+                    const uint32_t slot = slot_of(hashes[key], displacement, entry_count);
+                    if (occupied[slot] || std::find(candidate.begin(), candidate.end(), slot) != candidate.end()) {
+                        placed = false;
+                        break;
+                    }
+                    candidate.push_back(slot);
+                }
+
+                if (placed) {
+                    displacements[bucket] = displacement;
+                    for (size_t i = 0; i < candidate.size(); ++i) {
+                        occupied[candidate[i]] = true;
+                        slot_of_key[buckets[bucket][i]] = candidate[i];
+                    }
+                }
+            }
+
+            if (!placed) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    std::string entity_tag(const std::string& content, const char* suffix) {
+        char tag[40];
+        std::snprintf(tag, sizeof(tag), "\"%016llx%s\"",
+                      static_cast<unsigned long long>(path_hash(content, 0)), suffix);
+        return tag;
+    }
+
+    struct PackedFile {
+        std::string path;
+        std::filesystem::path source;
+        std::filesystem::path gzip_source;
+    };
+}
+
+Archive::~Archive() {
+#ifdef _WIN32
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+    if (mapping) {
+        CloseHandle(mapping);
+    }
+#else
+    if (data) {
+        munmap(const_cast<char*>(data), data_size);
+    }
+#endif
+}
+
+std::shared_ptr<const Archive> Archive::open(const char* path) {
+    std::shared_ptr<Archive> archive(new Archive);
+
+#ifdef _WIN32
+    const HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Unable to open archive " << path << std::endl;
+        return nullptr;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < static_cast<LONGLONG>(sizeof(FileHeader))) {
+        std::cerr << "Archive " << path << " is truncated." << std::endl;
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    archive->mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!archive->mapping) {
+        std::cerr << "Unable to map archive " << path << std::endl;
+        return nullptr;
+    }
+
+    archive->data = static_cast<const char*>(MapViewOfFile(archive->mapping, FILE_MAP_READ, 0, 0, 0));
+    archive->data_size = static_cast<size_t>(file_size.QuadPart);
+#else
+    const int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Unable to open archive " << path << std::endl;
+        return nullptr;
+    }
+
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+        std::cerr << "Archive " << path << " is truncated." << std::endl;
+        close(fd);
+        return nullptr;
+    }
+
+    void* mapped = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped != MAP_FAILED) {
+        archive->data = static_cast<const char*>(mapped);
+        archive->data_size = static_cast<size_t>(file_stat.st_size);
+    }
+#endif
+
+    if (!archive->data) {
+        std::cerr << "Unable to map archive " << path << std::endl;
+        return nullptr;
+    }
+
+    FileHeader header{};
+    std::memcpy(&header, archive->data, sizeof(header));
+
+    if (std::memcmp(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0 ||
+        header.version != ARCHIVE_VERSION || header.byte_order != ARCHIVE_BYTE_ORDER) {
+        std::cerr << "Archive " << path << " has an unsupported format." << std::endl;
+        return nullptr;
+    }
+
+    const uint64_t size = archive->data_size;
+    if (header.file_size != size || header.entry_count == 0 || header.bucket_count == 0 ||
+        header.displacement_offset % alignof(uint32_t) != 0 ||
+        !in_bounds(header.displacement_offset, uint64_t{header.bucket_count} * sizeof(uint32_t), size) ||
+        !in_bounds(header.record_offset, uint64_t{header.entry_count} * sizeof(Record), size)) {
+        std::cerr << "Archive " << path << " is corrupt." << std::endl;
+        return nullptr;
+    }
+
+    archive->seed = header.seed;
+    archive->bucket_count = header.bucket_count;
+    archive->entry_count = header.entry_count;
+    archive->displacements = reinterpret_cast<const uint32_t*>(archive->data + header.displacement_offset);
+    archive->slots = std::make_unique<Slot[]>(header.entry_count);
+
+    for (uint32_t i = 0; i < header.entry_count; ++i) {
+        Record record{};
+        std::memcpy(&record, archive->data + header.record_offset + i * sizeof(Record), sizeof(Record));
+
+        if (!in_bounds(record.path_offset, record.path_length, size) ||
+            !in_bounds(record.headers_offset, record.headers_length, size) ||
+            !in_bounds(record.body_offset, record.body_length, size) ||
+            !in_bounds(record.gzip_headers_offset, record.gzip_headers_length, size) ||
+            !in_bounds(record.gzip_body_offset, record.gzip_body_length, size)) {
+            std::cerr << "Archive " << path << " is corrupt." << std::endl;
+            return nullptr;
+        }
+
+        const auto view = [&archive](const uint64_t offset, const uint64_t length) {
+            return std::string_view(archive->data + offset, length);
+        };
+
+        Slot& slot = archive->slots[i];
+        slot.hash = record.hash;
+        slot.path = view(record.path_offset, record.path_length);
+        slot.entry.headers = view(record.headers_offset, record.headers_length);
+        slot.entry.body = view(record.body_offset, record.body_length);
+        slot.entry.gzip_headers = view(record.gzip_headers_offset, record.gzip_headers_length);
+        slot.entry.gzip_body = view(record.gzip_body_offset, record.gzip_body_length);
+    }
+
+    // HTML pages are scanned for preload links once here, not per request. Aliases share
+    // the body of the page they stand for and take its links.
+    std::unordered_map<const char*, const Slot*> pages;
+    for (uint32_t i = 0; i < archive->entry_count; ++i) {
+        Slot& slot = archive->slots[i];
+        if (slot.path.ends_with(".html") && pages.emplace(slot.entry.body.data(), &slot).second) {
+            slot.links = preload_links(slot.entry.body);
+        }
+    }
+    for (uint32_t i = 0; i < archive->entry_count; ++i) {
+        Slot& slot = archive->slots[i];
+        const auto it = pages.find(slot.entry.body.data());
+        if (it == pages.end() || it->second->entry.body.size() != slot.entry.body.size()) {
+            continue;
+        }
+        if (it->second != &slot) {
+            slot.links = it->second->links;
+        }
+        slot.entry.links = slot.links;
+    }
+
+    return archive;
+}
+
+const Archive::Entry* Archive::find(const std::string_view path) const {
+    const uint64_t hash = path_hash(path, seed);
+    const uint32_t displacement = displacements[bucket_of(hash, bucket_count)];
+    const Slot& slot = slots[slot_of(hash, displacement, entry_count)];
+
+    if (slot.hash != hash || slot.path != path) {
+        return nullptr;
+    }
+
+    return &slot.entry;
+}
+
+bool archive_pack(const char* www_dir, const char* archive_path) {
+    namespace fs = std::filesystem;
+
+    std::error_code error;
+    if (!fs::is_directory(www_dir, error)) {
+        std::cerr << "Document root " << www_dir << " is not a directory." << std::endl;
+        return false;
+    }
+
+    // Collect files keyed by request path. A "name.gz" sibling of "name" is
+    // stored as its precompressed variant rather than as a file of its own.
+    std::map<std::string, PackedFile> files;
+    for (auto it = fs::recursive_directory_iterator(www_dir, error); !error && it != fs::recursive_directory_iterator();
+         it.increment(error)) {
+        if (!it->is_regular_file()) {
+            continue;
+        }
+
+        std::string path = "/" + it->path().lexically_relative(www_dir).generic_string();
+        files[path] = {path, it->path(), {}};
+    }
+
+    if (error) {
+        std::cerr << "Unable to read " << www_dir << ": " << error.message() << std::endl;
+        return false;
+    }
+
+    for (auto it = files.begin(); it != files.end();) {
+        if (it->first.ends_with(".gz")) {
+            if (const auto original = files.find(it->first.substr(0, it->first.size() - 3)); original != files.end()) {
+                original->second.gzip_source = it->second.source;
+                it = files.erase(it);
+                continue;
+            }
+        }
+        ++it;
+    }
+
+    if (files.empty()) {
+        std::cerr << "Document root " << www_dir << " is empty." << std::endl;
+        return false;
+    }
+
+    // Request paths that resolve to a file: the file itself, "/name" for
+    // "/name.html", and "/dir/" for "/dir/index.html". Real files win over aliases.
+    std::map<std::string, const PackedFile*> keys;
+    for (const auto& [path, file] : files) {
+        keys[path] = &file;
+    }
+    for (const auto& [path, file] : files) {
+        if (path.ends_with("/index.html")) {
+            keys.try_emplace(path.substr(0, path.size() - 10), &file);
+        }
+        if (path.ends_with(".html")) {
+            keys.try_emplace(path.substr(0, path.size() - 5), &file);
+        }
+    }
+
+    std::vector<std::string> key_paths;
+    std::vector<const PackedFile*> key_files;
+    for (const auto& [path, file] : keys) {
+        key_paths.push_back(path);
+        key_files.push_back(file);
+    }
+
+    const auto entry_count = static_cast<uint32_t>(key_paths.size());
+    const uint32_t bucket_count = std::max<uint32_t>(1, (entry_count + KEYS_PER_BUCKET - 1) / KEYS_PER_BUCKET);
+
+    uint64_t seed = 0;
+    std::vector<uint64_t> hashes(entry_count);
+    std::vector<uint32_t> displacements;
+    std::vector<uint32_t> slot_of_key;
+
+    for (;; ++seed) {
+        for (uint32_t i = 0; i < entry_count; ++i) {
+            hashes[i] = path_hash(key_paths[i], seed);
+        }
+        if (build_perfect_hash(hashes, bucket_count, displacements, slot_of_key)) {
+            break;
+        }
+    }
+
+    // Read bodies and precompute headers once per file, shared by its aliases.
+    struct FileData {
+        std::string headers;
+        std::string body;
+        std::string gzip_headers;
+        std::string gzip_body;
+        uint64_t body_offset = 0;
+        uint64_t gzip_body_offset = 0;
+    };
+
+    std::map<const PackedFile*, FileData> contents;
+    for (const auto& [path, file] : files) {
+        FileData& content = contents[&file];
+
+        std::ifstream input(file.source, std::ios::binary);
+        content.body.assign(std::istreambuf_iterator(input), std::istreambuf_iterator<char>());
+        if (!input.good() && !input.eof()) {
+            std::cerr << "Unable to read " << file.source.string() << std::endl;
+            return false;
+        }
+
+        const std::string type = content_type(fs::path(path).extension().string());
+        const std::string vary = file.gzip_source.empty() ? "" : "Vary: Accept-Encoding\r\n";
+
+        content.headers = "Content-Type: " + type + "\r\n" +
+                          "Content-Length: " + std::to_string(content.body.size()) + "\r\n" +
+                          "ETag: " + entity_tag(content.body, "") + "\r\n" + vary;
+
+        if (!file.gzip_source.empty()) {
+            std::ifstream gzip_input(file.gzip_source, std::ios::binary);
+            content.gzip_body.assign(std::istreambuf_iterator(gzip_input), std::istreambuf_iterator<char>());
+
+            content.gzip_headers = "Content-Type: " + type + "\r\n" +
+                                   "Content-Encoding: gzip\r\n" +
+                                   "Content-Length: " + std::to_string(content.gzip_body.size()) + "\r\n" +
+                                   "ETag: " + entity_tag(content.body, "-gz") + "\r\n" + vary;
+        }
+    }
+
+    // String region: paths and header blocks, directly after the record table.
+    const uint64_t displacement_offset = sizeof(FileHeader);
+    const uint64_t record_offset = align_up(displacement_offset + uint64_t{bucket_count} * sizeof(uint32_t),
+                                            alignof(Record));
+    const uint64_t string_offset = record_offset + uint64_t{entry_count} * sizeof(Record);
+
+    std::string strings;
+    std::map<const PackedFile*, std::pair<uint64_t, uint64_t>> header_offsets;
+    for (auto& [file, content] : contents) {
+        const uint64_t headers_offset = string_offset + strings.size();
+        strings += content.headers;
+        const uint64_t gzip_headers_offset = string_offset + strings.size();
+        strings += content.gzip_headers;
+        header_offsets[file] = {headers_offset, gzip_headers_offset};
+    }
+
+    std::vector<Record> records(entry_count);
+    for (uint32_t i = 0; i < entry_count; ++i) {
+        const uint64_t path_offset = string_offset + strings.size();
+        strings += key_paths[i];
+
+        Record& record = records[slot_of_key[i]];
+        record.hash = hashes[i];
+        record.path_offset = path_offset;
+        record.path_length = key_paths[i].size();
+    }
+
+    // Bodies are page-aligned so they can be handed to the kernel straight from the mapping.
+    uint64_t offset = align_up(string_offset + strings.size(), ARCHIVE_PAGE_SIZE);
+    for (auto& [file, content] : contents) {
+        content.body_offset = offset;
+        offset = align_up(offset + content.body.size(), ARCHIVE_PAGE_SIZE);
+        content.gzip_body_offset = offset;
+        offset = align_up(offset + content.gzip_body.size(), ARCHIVE_PAGE_SIZE);
+    }
+
+    for (uint32_t i = 0; i < entry_count; ++i) {
+        const FileData& content = contents[key_files[i]];
+        const auto& [headers_offset, gzip_headers_offset] = header_offsets[key_files[i]];
+
+        Record& record = records[slot_of_key[i]];
+        record.headers_offset = headers_offset;
+        record.headers_length = content.headers.size();
+        record.body_offset = content.body_offset;
+        record.body_length = content.body.size();
+        record.gzip_headers_offset = gzip_headers_offset;
+        record.gzip_headers_length = content.gzip_headers.size();
+        record.gzip_body_offset = content.gzip_body_offset;
+        record.gzip_body_length = content.gzip_body.size();
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+    header.version = ARCHIVE_VERSION;
+    header.byte_order = ARCHIVE_BYTE_ORDER;
+    header.seed = seed;
+    header.bucket_count = bucket_count;
+    header.entry_count = entry_count;
+    header.displacement_offset = displacement_offset;
+    header.record_offset = record_offset;
+    header.file_size = offset;
+
+    // Write to a temporary file and rename it into place, so a running server
+    // reloading the archive never maps a half-written file.
+    const std::string temporary_path = std::string(archive_path) + ".tmp";
+    std::ofstream output(temporary_path, std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+        std::cerr << "Unable to create archive " << archive_path << std::endl;
+        return false;
+    }
+
+    const auto pad_to = [&output](const uint64_t position) {
+        const auto current = static_cast<uint64_t>(output.tellp());
+        if (position > current) {
+            const std::string padding(position - current, '\0');
+            output.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+        }
+    };
+
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(reinterpret_cast<const char*>(displacements.data()),
+                 static_cast<std::streamsize>(displacements.size() * sizeof(uint32_t)));
+    pad_to(record_offset);
+    output.write(reinterpret_cast<const char*>(records.data()),
+                 static_cast<std::streamsize>(records.size() * sizeof(Record)));
+    output.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+
+    for (const auto& [file, content] : contents) {
+        pad_to(content.body_offset);
+        output.write(content.body.data(), static_cast<std::streamsize>(content.body.size()));
+        pad_to(content.gzip_body_offset);
+        output.write(content.gzip_body.data(), static_cast<std::streamsize>(content.gzip_body.size()));
+    }
+    pad_to(offset);
+    output.close();
+
+    if (!output) {
+        std::cerr << "Unable to write archive " << archive_path << std::endl;
+        fs::remove(temporary_path, error);
+        return false;
+    }
+
+    fs::rename(temporary_path, archive_path, error);
+    if (error) {
+        std::cerr << "Unable to write archive " << archive_path << ": " << error.message() << std::endl;
+        return false;
+    }
+
+    std::cout << "Packed " << files.size() << " files (" << entry_count << " paths) from " << www_dir
+              << " into " << archive_path << std::endl;
+    return true;
+}
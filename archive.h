@@ -0,0 +1,58 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Immutable, memory-mapped pack of the www tree produced by "jella pack".
+//
+// Layout: a fixed header, a displacement table and an entry table for a
+// hash-and-displace perfect hash over request paths, a string region holding
+// the paths and precomputed header lines, then page-aligned bodies.
+class Archive {
+public:
+    struct Entry {
+        std::string_view headers;       // "Name: value\r\n" lines for the identity body.
+        std::string_view body;
+        std::string_view gzip_headers;  // Empty when the file has no precompressed variant.
+        std::string_view gzip_body;
+        std::string_view links;         // Preload Link header lines for an HTML page, found when the archive opens.
+    };
+
+    ~Archive();
+
+    Archive(const Archive&) = delete;
+    Archive& operator=(const Archive&) = delete;
+
+    static std::shared_ptr<const Archive> open(const char* path);
+
+    [[nodiscard]] const Entry* find(std::string_view path) const;
+    [[nodiscard]] size_t size() const { return entry_count; }
+
+private:
+    Archive() = default;
+
+    const char* data = nullptr;
+    size_t data_size = 0;
+    void* mapping = nullptr;
+
+    uint64_t seed = 0;
+    uint32_t bucket_count = 0;
+    uint32_t entry_count = 0;
+    const uint32_t* displacements = nullptr;
+
+    struct Slot {
+        uint64_t hash;
+        std::string_view path;
+        Entry entry;
+        std::string links;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+};
+
+bool archive_pack(const char* www_dir, const char* archive_path);
+
+#endif // ARCHIVE_H
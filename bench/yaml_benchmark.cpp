@@ -0,0 +1,246 @@
+// Throughput, allocation and peak heap benchmark for the YAML parser in yaml/.
+// Built with -DJELLA_BUILD_BENCHMARKS=ON; run bin/yaml_benchmark [seconds per case].
+//
+// Every case is generated in memory, so runs are comparable across machines and
+// commits. Times are the best of repeated runs; allocations and peak heap are from a
+// warm run, after the node pool has grown, which is what a long-running server sees.
+
+#include "../yaml/Yaml.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+    struct HeapStats {
+        size_t allocations = 0;
+        size_t live_bytes = 0;
+        size_t peak_bytes = 0;
+    };
+
+    HeapStats heap;
+
+    // Each block carries a header holding its size and the offset back to the start of
+    // the underlying allocation, so delete can account for it and free it.
+    constexpr size_t HEADER_SIZE = 2 * sizeof(size_t);
+
+    void* tracked_allocate(const size_t size, const size_t alignment) {
+        const size_t offset = (HEADER_SIZE + alignment - 1) / alignment * alignment;
+        const size_t total = (offset + size + alignment - 1) / alignment * alignment;
+#ifdef _WIN32
+        char* base = static_cast<char*>(_aligned_malloc(total, alignment));
+#else
+        char* base = static_cast<char*>(std::aligned_alloc(alignment, total));
+#endif
+        if (!base) {
+            throw std::bad_alloc();
+        }
+
+        char* block = base + offset;
+        reinterpret_cast<size_t*>(block)[-1] = size;
+        reinterpret_cast<size_t*>(block)[-2] = offset;
+
+        ++heap.allocations;
+        heap.live_bytes += size;
+        heap.peak_bytes = std::max(heap.peak_bytes, heap.live_bytes);
+        return block;
+    }
+
+    void tracked_free(void* pointer) {
+        if (!pointer) {
+            return;
+        }
+
+        char* block = static_cast<char*>(pointer);
+        heap.live_bytes -= reinterpret_cast<size_t*>(block)[-1];
+#ifdef _WIN32
+        _aligned_free(block - reinterpret_cast<size_t*>(block)[-2]);
+#else
+        std::free(block - reinterpret_cast<size_t*>(block)[-2]);
+#endif
+    }
+}
+
+void* operator new(const size_t size) {
+    return tracked_allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new[](const size_t size) {
+    return tracked_allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(const size_t size, const std::align_val_t alignment) {
+    return tracked_allocate(size, std::max(static_cast<size_t>(alignment), alignof(std::max_align_t)));
+}
+
+void* operator new[](const size_t size, const std::align_val_t alignment) {
+    return tracked_allocate(size, std::max(static_cast<size_t>(alignment), alignof(std::max_align_t)));
+}
+
+void operator delete(void* pointer) noexcept { tracked_free(pointer); }
+void operator delete[](void* pointer) noexcept { tracked_free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { tracked_free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { tracked_free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { tracked_free(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { tracked_free(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { tracked_free(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { tracked_free(pointer); }
+
+namespace {
+    using clock = std::chrono::steady_clock;
+
+    struct Case {
+        const char* name;
+        std::string input;
+    };
+
+    // A config like ours, repeated as separate documents would be; parsed one at a time.
+    std::string small_config() {
+        return "port: 443\n"
+               "https: true\n"
+               "cert: /etc/jella/server.crt\n"
+               "key: /etc/jella/server.key\n"
+               "archive: www.jpk\n"
+               "header_timeout: 10\n"
+               "keepalive_timeout: 5\n"
+               "write_timeout: 30\n"
+               "max_connections: 10000\n"
+               "shed_lag: 0.25\n"
+               "retry_after: 5\n"
+               "connection_rate: 20\n"
+               "connection_burst: 40\n"
+               "request_rate: 100\n"
+               "request_burst: 200\n";
+    }
+
+    std::string deep_nesting(const size_t depth, const size_t branches) {
+        std::string out;
+        for (size_t branch = 0; branch < branches; ++branch) {
+            out += "branch_" + std::to_string(branch) + ":\n";
+            for (size_t level = 1; level < depth; ++level) {
+                out.append(level * 2, ' ');
+                out += "level_" + std::to_string(level) + ":\n";
+            }
+            out.append(depth * 2, ' ');
+            out += "leaf: " + std::to_string(branch) + "\n";
+        }
+        return out;
+    }
+
+    std::string large_sequence(const size_t items) {
+        std::string out;
+        for (size_t i = 0; i < items; ++i) {
+            out += "- item_" + std::to_string(i) + "\n";
+        }
+        return out;
+    }
+
+    std::string folded_scalars(const size_t keys, const size_t lines) {
+        std::string out;
+        for (size_t key = 0; key < keys; ++key) {
+            out += "text_" + std::to_string(key) + ": >\n";
+            for (size_t line = 0; line < lines; ++line) {
+                out += "  Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod "
+                       + std::to_string(line) + "\n";
+            }
+        }
+        return out;
+    }
+
+    std::string quoted_keys(const size_t keys) {
+        std::string out;
+        for (size_t key = 0; key < keys; ++key) {
+            out += "\"quoted key " + std::to_string(key) + "\": 'quoted value " + std::to_string(key) + "'\n";
+        }
+        return out;
+    }
+
+    // Discards events, to time the parser without building a tree.
+    class NullHandler : public Yaml::EventHandler {
+    };
+
+    struct Measurement {
+        double best_seconds = 0;
+        size_t allocations = 0;
+        size_t peak_bytes = 0;
+    };
+
+    // Runs body at least three times and until budget has passed; the last run is a warm one.
+    Measurement measure(const std::function<void()>& body, const double budget) {
+        Measurement result;
+        result.best_seconds = 1e9;
+
+        const auto start = clock::now();
+        for (size_t run = 0; run < 3 || std::chrono::duration<double>(clock::now() - start).count() < budget; ++run) {
+            const size_t allocations = heap.allocations;
+            const size_t live_bytes = heap.live_bytes;
+            heap.peak_bytes = live_bytes;
+
+            const auto run_start = clock::now();
+            body();
+            const double seconds = std::chrono::duration<double>(clock::now() - run_start).count();
+
+            result.best_seconds = std::min(result.best_seconds, seconds);
+            result.allocations = heap.allocations - allocations;
+            result.peak_bytes = heap.peak_bytes - live_bytes;
+        }
+        return result;
+    }
+
+    double megabytes_per_second(const size_t bytes, const Measurement& measurement) {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0) / measurement.best_seconds;
+    }
+}
+
+int main(const int argc, char* argv[]) {
+    const double budget = argc >= 2 ? std::atof(argv[1]) : 0.5;
+
+    const std::vector<Case> cases = {
+        {"small config", small_config()},
+        {"deep nesting", deep_nesting(64, 200)},
+        {"100k sequence", large_sequence(100000)},
+        {"folded scalars", folded_scalars(500, 40)},
+        {"quoted keys", quoted_keys(50000)},
+    };
+
+    std::printf("%-16s %10s %12s %12s %12s %13s %14s %13s\n", "case", "input KB",
+                "parse MB/s", "events MB/s", "write MB/s", "parse allocs", "parse peak KB", "write allocs");
+
+    for (const Case& test : cases) {
+        Yaml::Node root;
+
+        const Measurement parse = measure([&] {
+            Yaml::Node node;
+            Yaml::Parse(node, test.input);
+        }, budget);
+
+        const Measurement events = measure([&] {
+            NullHandler handler;
+            Yaml::Parse(handler, test.input);
+        }, budget);
+
+        Yaml::Parse(root, test.input);
+        std::string output;
+        const Measurement serialize = measure([&] {
+            output.clear();
+            Yaml::Serialize(root, output);
+        }, budget);
+
+        std::printf("%-16s %10.1f %12.1f %12.1f %12.1f %13zu %14.1f %13zu\n", test.name,
+                    static_cast<double>(test.input.size()) / 1024.0,
+                    megabytes_per_second(test.input.size(), parse),
+                    megabytes_per_second(test.input.size(), events),
+                    megabytes_per_second(output.size(), serialize),
+                    parse.allocations,
+                    static_cast<double>(parse.peak_bytes) / 1024.0,
+                    serialize.allocations);
+    }
+
+    return 0;
+}
@@ -0,0 +1,325 @@
+#include "config.h"
+#include "timer_wheel.h"
+
+#include "yaml/Yaml.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <string_view>
+
+namespace {
+    // Durations end up as deadlines on the server's timer wheel (about 19 days at most), so
+    // a longer one would fire early.
+    constexpr auto MAX_DURATION = TimerWheel::max_delay(TIMER_TICK);
+
+    template<typename T>
+    bool parse_number(const std::string_view value, T& out) {
+        const char* end = value.data() + value.size();
+        const auto [ptr, error] = std::from_chars(value.data(), end, out);
+        return error == std::errc() && ptr == end;
+    }
+
+    bool parse_non_negative(const std::string_view value, double& out) {
+        return parse_number(value, out) && std::isfinite(out) && out >= 0;
+    }
+
+    bool parse_seconds(const std::string_view value, std::chrono::milliseconds& out) {
+        double seconds = 0;
+        if (!parse_non_negative(value, seconds) || seconds * 1000 > static_cast<double>(MAX_DURATION.count())) {
+            return false;
+        }
+
+        // A value too small to count in milliseconds still sets a deadline rather than turning it off.
+        out = std::chrono::milliseconds(static_cast<long long>(seconds * 1000));
+        if (seconds > 0 && out.count() == 0) {
+            out = std::chrono::milliseconds(1);
+        }
+        return true;
+    }
+
+    bool parse_bool(const std::string_view value, bool& out) {
+        std::string lower(value);
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](const unsigned char c) {
+            return static_cast<char>(std::tolower(c));
+        });
+
+        if (lower == "true" || lower == "yes" || lower == "1") {
+            out = true;
+            return true;
+        }
+        if (lower == "false" || lower == "no" || lower == "0") {
+            out = false;
+            return true;
+        }
+        return false;
+    }
+
+    using Report = std::function<void(size_t line, const std::string& message)>;
+
+    // A host name, or a wildcard standing for one label in front of a name with at least
+    // two labels of its own.
+    bool valid_host(const std::string_view host) {
+        std::string_view name = host;
+        if (name.starts_with("*.")) {
+            name.remove_prefix(2);
+            if (name.find('.') == std::string_view::npos) {
+                return false;
+            }
+        }
+
+        if (name.empty() || name.front() == '.' || name.back() == '.' || name.find("..") != std::string_view::npos) {
+            return false;
+        }
+        return std::all_of(name.begin(), name.end(), [](const unsigned char c) {
+            return std::isalnum(c) || c == '-' || c == '.';
+        });
+    }
+
+    bool assign_certificates(const Yaml::Node& node, Config& config, const Report& report) {
+        if (!node.IsSequence()) {
+            report(node.Line(), "'certificates' expects a list of entries with host, cert and key");
+            return false;
+        }
+
+        bool valid = true;
+        config.certificates.clear();
+
+        for (auto it = node.Begin(); it != node.End(); it++) {
+            const Yaml::Node& entry = (*it).second;
+            if (!entry.IsMap()) {
+                report(entry.Line(), "a certificate entry expects host, cert and key");
+                valid = false;
+                continue;
+            }
+
+            CertificateConfig certificate;
+            bool entry_valid = true;
+
+            for (auto field = entry.Begin(); field != entry.End(); field++) {
+                const auto& [key, value] = *field;
+                std::string* target = key == "host" ? &certificate.host
+                                      : key == "cert" ? &certificate.cert_path
+                                      : key == "key" ? &certificate.key_path
+                                      : key == "ecdsa_cert" ? &certificate.ecdsa_cert_path
+                                      : key == "ecdsa_key" ? &certificate.ecdsa_key_path
+                                      : nullptr;
+                if (!target) {
+                    report(value.Line(), "unknown certificate setting '" + key + "'");
+                    entry_valid = false;
+                } else if (!value.IsScalar()) {
+                    report(value.Line(), "'" + key + "' expects " + (key == "host" ? "a host name" : "a file path"));
+                    entry_valid = false;
+                } else {
+                    *target = value.AsStringView();
+                }
+            }
+
+            if (entry_valid && (certificate.host.empty() || certificate.cert_path.empty() || certificate.key_path.empty())) {
+                report(entry.Line(), "a certificate entry needs host, cert and key");
+                entry_valid = false;
+            } else if (entry_valid && certificate.ecdsa_cert_path.empty() != certificate.ecdsa_key_path.empty()) {
+                report(entry.Line(), "'ecdsa_cert' and 'ecdsa_key' go together");
+                entry_valid = false;
+            } else if (entry_valid && !valid_host(certificate.host)) {
+                report(entry.Line(), "'" + certificate.host + "' is not a host name or a *.domain wildcard");
+                entry_valid = false;
+            } else if (entry_valid) {
+                const auto same_host = [&certificate](const CertificateConfig& other) {
+                    return std::equal(other.host.begin(), other.host.end(), certificate.host.begin(),
+                                      certificate.host.end(), [](const unsigned char a, const unsigned char b) {
+                                          return std::tolower(a) == std::tolower(b);
+                                      });
+                };
+                if (std::any_of(config.certificates.begin(), config.certificates.end(), same_host)) {
+                    report(entry.Line(), "'" + certificate.host + "' has more than one certificate");
+                    entry_valid = false;
+                }
+            }
+
+            if (entry_valid) {
+                config.certificates.push_back(std::move(certificate));
+            }
+            valid = valid && entry_valid;
+        }
+        return valid;
+    }
+
+    // One entry per accepted key. assign converts the scalar value into its field and
+    // returns false if it is not a valid value, which "expected" then describes. Keys
+    // holding a list or map have assign_node instead, which reports its own errors.
+    struct Field {
+        const char* key;
+        const char* expected;
+        bool (*assign)(std::string_view value, Config& config);
+        bool (*assign_node)(const Yaml::Node& node, Config& config, const Report& report) = nullptr;
+    };
+
+    const Field FIELDS[] = {
+        {"port", "a port number from 0 to 65535", [](const std::string_view value, Config& config) {
+            return parse_number(value, config.port) && config.port >= 0 && config.port <= 65535;
+        }},
+        {"https", "true or false", [](const std::string_view value, Config& config) {
+            return parse_bool(value, config.https);
+        }},
+        {"cert", "a file path", [](const std::string_view value, Config& config) {
+            config.cert_path = value;
+            return !value.empty();
+        }},
+        {"key", "a file path", [](const std::string_view value, Config& config) {
+            config.key_path = value;
+            return !value.empty();
+        }},
+        {"ecdsa_cert", "a file path", [](const std::string_view value, Config& config) {
+            config.ecdsa_cert_path = value;
+            return !value.empty();
+        }},
+        {"ecdsa_key", "a file path", [](const std::string_view value, Config& config) {
+            config.ecdsa_key_path = value;
+            return !value.empty();
+        }},
+        {"certificates", nullptr, nullptr, assign_certificates},
+        {"http2", "true or false", [](const std::string_view value, Config& config) {
+            return parse_bool(value, config.http2);
+        }},
+        {"early_hints", "true or false", [](const std::string_view value, Config& config) {
+            return parse_bool(value, config.early_hints);
+        }},
+        {"max_early_data", "a byte count", [](const std::string_view value, Config& config) {
+            return parse_number(value, config.max_early_data);
+        }},
+        {"handshake_threads", "a thread count", [](const std::string_view value, Config& config) {
+            return parse_number(value, config.handshake_threads);
+        }},
+        {"handshake_queue", "a connection count", [](const std::string_view value, Config& config) {
+            return parse_number(value, config.handshake_queue);
+        }},
+        {"archive", "a file path", [](const std::string_view value, Config& config) {
+            config.archive_path = value;
+            return true;
+        }},
+        {"header_timeout", "a number of seconds up to 19 days", [](const std::string_view value, Config& config) {
+            return parse_seconds(value, config.header_timeout);
+        }},
+        {"keepalive_timeout", "a number of seconds up to 19 days", [](const std::string_view value, Config& config) {
+            return parse_seconds(value, config.keepalive_timeout);
+        }},
+        {"write_timeout", "a number of seconds up to 19 days", [](const std::string_view value, Config& config) {
+            return parse_seconds(value, config.write_timeout);
+        }},
+        {"max_connections", "a connection count", [](const std::string_view value, Config& config) {
+            return parse_number(value, config.max_connections);
+        }},
+        {"shed_lag", "a number of seconds up to 19 days", [](const std::string_view value, Config& config) {
+            return parse_seconds(value, config.shed_lag);
+        }},
+        {"retry_after", "a whole number of seconds", [](const std::string_view value, Config& config) {
+            unsigned seconds = 0;
+            if (!parse_number(value, seconds)) {
+                return false;
+            }
+            config.retry_after = std::chrono::seconds(seconds);
+            return true;
+        }},
+        {"connection_rate", "a non-negative number", [](const std::string_view value, Config& config) {
+            return parse_non_negative(value, config.connection_rate);
+        }},
+        {"connection_burst", "a non-negative number", [](const std::string_view value, Config& config) {
+            return parse_non_negative(value, config.connection_burst);
+        }},
+        {"request_rate", "a non-negative number", [](const std::string_view value, Config& config) {
+            return parse_non_negative(value, config.request_rate);
+        }},
+        {"request_burst", "a non-negative number", [](const std::string_view value, Config& config) {
+            return parse_non_negative(value, config.request_burst);
+        }},
+    };
+
+    const Field* find_field(const std::string_view key) {
+        for (const Field& field : FIELDS) {
+            if (key == field.key) {
+                return &field;
+            }
+        }
+        return nullptr;
+    }
+}
+
+bool load_config(const std::string& path, Config& config) {
+    Yaml::Node root;
+    try {
+        Yaml::Parse(root, path.c_str());
+    }
+    catch (const Yaml::Exception& e) {
+        std::cerr << path << ": " << e.what() << std::endl;
+        return false;
+    }
+
+    if (root.IsNone()) {
+        return true;
+    }
+
+    const auto report = [&path](const size_t line, const std::string& message) {
+        std::cerr << path << ":" << line << ": " << message << std::endl;
+    };
+
+    if (!root.IsMap()) {
+        report(root.Line(), "expected a map of settings");
+        return false;
+    }
+
+    Config parsed = config;
+    bool valid = true;
+    bool names_default_certificate = false;
+
+    for (auto it = root.Begin(); it != root.End(); it++) {
+        const auto& [key, node] = *it;
+
+        const Field* field = find_field(key);
+        if (!field) {
+            report(node.Line(), "unknown setting '" + key + "'");
+            valid = false;
+            continue;
+        }
+
+        // An empty value keeps the default.
+        if (node.IsNone()) {
+            continue;
+        }
+
+        if (key == "cert" || key == "key" || key == "ecdsa_cert" || key == "ecdsa_key") {
+            names_default_certificate = true;
+        }
+
+        if (field->assign_node) {
+            valid = field->assign_node(node, parsed, report) && valid;
+            continue;
+        }
+
+        if (!node.IsScalar() || !field->assign(node.AsStringView(), parsed)) {
+            report(node.Line(), "'" + key + "' expects " + field->expected);
+            valid = false;
+        }
+    }
+
+    // Without a cert and key of its own, the default certificate is the first host's.
+    if (!names_default_certificate && !parsed.certificates.empty()) {
+        parsed.cert_path = parsed.certificates.front().cert_path;
+        parsed.key_path = parsed.certificates.front().key_path;
+        parsed.ecdsa_cert_path = parsed.certificates.front().ecdsa_cert_path;
+        parsed.ecdsa_key_path = parsed.certificates.front().ecdsa_key_path;
+    }
+
+    if (parsed.ecdsa_cert_path.empty() != parsed.ecdsa_key_path.empty()) {
+        report(root.Line(), "'ecdsa_cert' and 'ecdsa_key' go together");
+        valid = false;
+    }
+
+    if (valid) {
+        config = std::move(parsed);
+    }
+    return valid;
+}
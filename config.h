@@ -0,0 +1,80 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A certificate served to clients that ask for host by name (SNI). It can come with an
+// ECDSA certificate besides the RSA one; clients that support it get the ECDSA one, for
+// a much cheaper handshake.
+struct CertificateConfig {
+    std::string host;       // "example.com", or "*.example.com" for any single label under it.
+    std::string cert_path;
+    std::string key_path;
+    std::string ecdsa_cert_path;
+    std::string ecdsa_key_path;
+};
+
+// Resolution of the per-connection deadlines below.
+constexpr std::chrono::milliseconds TIMER_TICK{100};
+
+// Typed server configuration. It is compiled once from YAML and then published as an
+// immutable snapshot (std::shared_ptr<const Config>), so code on the request path reads
+// plain fields through a pointer with no lookups or conversions.
+struct Config {
+    int port = 80;
+    bool https = false;
+    std::string cert_path = "server.crt";
+    std::string key_path = "server.key";
+    std::string ecdsa_cert_path;                        // Optional ECDSA certificate next to the RSA one.
+    std::string ecdsa_key_path;
+    std::vector<CertificateConfig> certificates;        // Per-host certificates; cert/key serve every other name.
+    std::string archive_path;                           // Empty serves the www directory.
+
+    // HTTP/2, offered through ALPN on HTTPS and taken on plain HTTP from clients that start
+    // with the HTTP/2 preface. Without it every client speaks HTTP/1.1.
+    bool http2 = true;
+
+    // Link preload headers for the stylesheets, scripts and fonts an HTML page needs, sent in
+    // a 103 Early Hints ahead of the page and again with it.
+    bool early_hints = true;
+
+    // TLS 1.3 0-RTT: resumed clients may send this many bytes of requests with their first
+    // flight, and GET and HEAD among them are answered before the handshake completes.
+    // Zero disables early data.
+    uint32_t max_early_data = 0;
+
+    // TLS handshakes run on this many threads, off the event loop; zero runs them inline.
+    // Accepting pauses while handshake_queue connections are in the pool (zero: no limit).
+    size_t handshake_threads = 2;
+    size_t handshake_queue = 1024;
+
+    // Per-connection deadlines; zero disables one. They run on a timer wheel that ticks
+    // every TIMER_TICK, which bounds how long a deadline can be.
+    std::chrono::milliseconds header_timeout{10000};    // Handshake and request headers, from the first byte.
+    std::chrono::milliseconds keepalive_timeout{5000};  // Idle between requests.
+    std::chrono::milliseconds write_timeout{30000};     // No progress writing a response.
+
+    // Admission control; zero disables a limit.
+    size_t max_connections = 10000;                     // Accepting pauses at this many open connections.
+    std::chrono::milliseconds shed_lag{250};            // Event loop lag above which requests get a 503.
+    std::chrono::seconds retry_after{5};                // Retry-After sent with shed requests.
+
+    // Per-client-IP token buckets, in events per second; zero rate disables one.
+    // A zero burst allows one second's worth of events.
+    double connection_rate = 0;
+    double connection_burst = 0;
+    double request_rate = 0;
+    double request_burst = 0;
+};
+
+// Reads the YAML file at path over the values already in config, in one pass over a
+// table of known keys. Every problem is reported to std::cerr as "path:line: message";
+// if there is any, config is left unchanged and false is returned.
+bool load_config(const std::string& path, Config& config);
+
+#endif // CONFIG_H
@@ -0,0 +1,38 @@
+#include "config_reloader.h"
+
+ConfigReloader::ConfigReloader(std::function<void()> reload) :
+    reload(std::move(reload)),
+    thread(&ConfigReloader::run, this) {
+}
+
+ConfigReloader::~ConfigReloader() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void ConfigReloader::request() {
+    {
+        std::lock_guard lock(mutex);
+        pending = true;
+    }
+    wake.notify_one();
+}
+
+void ConfigReloader::run() {
+    std::unique_lock lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return pending || stopping; });
+        if (stopping) {
+            return;
+        }
+
+        pending = false;
+        lock.unlock();
+        reload();
+        lock.lock();
+    }
+}
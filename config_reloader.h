@@ -0,0 +1,33 @@
+#ifndef CONFIG_RELOADER_H
+#define CONFIG_RELOADER_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Runs reloads on a background thread, so parsing, validating and loading certificates
+// never stall the event loop. The reload function publishes its own result; requests
+// made while one is running coalesce into a single further run.
+class ConfigReloader {
+public:
+    explicit ConfigReloader(std::function<void()> reload);
+    ~ConfigReloader();
+
+    ConfigReloader(const ConfigReloader&) = delete;
+    ConfigReloader& operator=(const ConfigReloader&) = delete;
+
+    void request();
+
+private:
+    void run();
+
+    std::function<void()> reload;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool pending = false;
+    bool stopping = false;
+    std::thread thread;
+};
+
+#endif // CONFIG_RELOADER_H
@@ -0,0 +1,241 @@
+#include "early_hints.h"
+
+#include <algorithm>
+#include <cctype>
+#include <vector>
+
+namespace {
+    // Render-blocking resources sit early in the head; past this many, hints stop paying off.
+    constexpr size_t MAX_PRELOAD_LINKS = 16;
+
+    struct Attribute {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    bool iequals(const std::string_view a, const std::string_view b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const char x, const char y) {
+            return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+        });
+    }
+
+    bool is_space(const char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+    }
+
+    // Whether a space-separated list (like rel) holds token.
+    bool has_token(std::string_view list, const std::string_view token) {
+        while (!list.empty()) {
+            while (!list.empty() && is_space(list.front())) {
+                list.remove_prefix(1);
+            }
+            size_t end = 0;
+            while (end < list.size() && !is_space(list[end])) {
+                ++end;
+            }
+            if (iequals(list.substr(0, end), token)) {
+                return true;
+            }
+            list.remove_prefix(end);
+        }
+        return false;
+    }
+
+    // Reads a tag from just after its '<' up to its '>': the name, with a leading '/' for an
+    // end tag, and the attributes. Returns the position after the tag.
+    size_t read_tag(const std::string_view html, size_t position, std::string_view& name,
+                    std::vector<Attribute>& attributes) {
+        const size_t name_start = position;
+        if (position < html.size() && html[position] == '/') {
+            ++position;
+        }
+        while (position < html.size() && !is_space(html[position]) && html[position] != '>' && html[position] != '/') {
+            ++position;
+        }
+        name = html.substr(name_start, position - name_start);
+
+        attributes.clear();
+        while (position < html.size() && html[position] != '>') {
+            if (is_space(html[position]) || html[position] == '/') {
+                ++position;
+                continue;
+            }
+
+            const size_t attribute_start = position;
+            while (position < html.size() && !is_space(html[position]) && html[position] != '=' &&
+                   html[position] != '>') {
+                ++position;
+            }
+            Attribute attribute{html.substr(attribute_start, position - attribute_start), {}};
+
+            while (position < html.size() && is_space(html[position])) {
+                ++position;
+            }
+            if (position < html.size() && html[position] == '=') {
+                ++position;
+                while (position < html.size() && is_space(html[position])) {
+                    ++position;
+                }
+
+                if (position < html.size() && (html[position] == '"' || html[position] == '\'')) {
+                    const size_t end = html.find(html[position], position + 1);
+                    if (end == std::string_view::npos) {
+                        return html.size();
+                    }
+                    attribute.value = html.substr(position + 1, end - position - 1);
+                    position = end + 1;
+                } else {
+                    const size_t value_start = position;
+                    while (position < html.size() && !is_space(html[position]) && html[position] != '>') {
+                        ++position;
+                    }
+                    attribute.value = html.substr(value_start, position - value_start);
+                }
+            }
+
+            attributes.push_back(attribute);
+        }
+
+        return position < html.size() ? position + 1 : position;
+    }
+
+    const Attribute* find_attribute(const std::vector<Attribute>& attributes, const std::string_view name) {
+        const auto it = std::find_if(attributes.begin(), attributes.end(), [name](const Attribute& attribute) {
+            return iequals(attribute.name, name);
+        });
+        return it != attributes.end() ? &*it : nullptr;
+    }
+
+    // Position after the end tag that closes a raw text element, whose content may hold '<'.
+    size_t skip_raw_text(const std::string_view html, size_t position, const std::string_view end_tag) {
+        while ((position = html.find("</", position)) != std::string_view::npos) {
+            if (iequals(html.substr(position + 2, end_tag.size()), end_tag)) {
+                const size_t end = html.find('>', position);
+                return end == std::string_view::npos ? html.size() : end + 1;
+            }
+            position += 2;
+        }
+        return html.size();
+    }
+
+    // The URL as it goes between the angle brackets of a Link header, or empty when it
+    // cannot go there: outside printable ASCII, or a scheme that fetches nothing.
+    std::string link_target(std::string_view href) {
+        std::string target;
+        while (!href.empty()) {
+            // Attribute values escape '&'; no other entity is expected in a URL.
+            if (href.starts_with("&amp;")) {
+                target.push_back('&');
+                href.remove_prefix(5);
+                continue;
+            }
+
+            const auto c = static_cast<unsigned char>(href.front());
+            if (c <= ' ' || c >= 0x7f || c == '<' || c == '>' || c == '"') {
+                return {};
+            }
+            target.push_back(static_cast<char>(c));
+            href.remove_prefix(1);
+        }
+
+        const std::string_view scheme = std::string_view(target).substr(0, target.find(':'));
+        if (target.empty() || iequals(scheme, "data") || iequals(scheme, "javascript")) {
+            return {};
+        }
+        return target;
+    }
+
+    void append_link(std::string& links, const std::string_view href, const std::string_view rel,
+                     const std::string_view as, const Attribute* crossorigin) {
+        const std::string target = link_target(href);
+        if (target.empty()) {
+            return;
+        }
+
+        links.append("Link: <").append(target).append(">; rel=").append(rel);
+        if (!as.empty()) {
+            links.append("; as=").append(as);
+        }
+        if (crossorigin) {
+            links.append(iequals(crossorigin->value, "use-credentials") ? "; crossorigin=use-credentials"
+                                                                          : "; crossorigin");
+        }
+        links.append("\r\n");
+    }
+}
+
+std::string preload_links(const std::string_view html) {
+    // A font is always fetched in CORS mode; a preload without crossorigin would not match it.
+    static constexpr Attribute ANONYMOUS{"crossorigin", ""};
+
+    std::string links;
+    size_t count = 0;
+    std::vector<Attribute> attributes;
+    size_t position = 0;
+
+    while (count < MAX_PRELOAD_LINKS && (position = html.find('<', position)) != std::string_view::npos) {
+        if (html.substr(position, 4) == "<!--") {
+            const size_t end = html.find("-->", position + 4);
+            if (end == std::string_view::npos) {
+                break;
+            }
+            position = end + 3;
+            continue;
+        }
+
+        std::string_view name;
+        position = read_tag(html, position + 1, name, attributes);
+
+        // Only the head is scanned. A <base> would change what relative URLs resolve to.
+        if (iequals(name, "body") || iequals(name, "/head")) {
+            break;
+        }
+        if (iequals(name, "base")) {
+            return {};
+        }
+
+        const Attribute* crossorigin = find_attribute(attributes, "crossorigin");
+        const size_t length = links.size();
+
+        if (iequals(name, "script")) {
+            const Attribute* src = find_attribute(attributes, "src");
+            const Attribute* type = find_attribute(attributes, "type");
+            if (src && type && iequals(type->value, "module")) {
+                append_link(links, src->value, "modulepreload", {}, crossorigin);
+            } else if (src && (!type || iequals(type->value, "text/javascript"))) {
+                append_link(links, src->value, "preload", "script", crossorigin);
+            }
+            position = skip_raw_text(html, position, "script");
+        } else if (iequals(name, "style")) {
+            position = skip_raw_text(html, position, "style");
+        } else if (iequals(name, "link")) {
+            const Attribute* rel = find_attribute(attributes, "rel");
+            const Attribute* href = find_attribute(attributes, "href");
+            const Attribute* as = find_attribute(attributes, "as");
+            const Attribute* media = find_attribute(attributes, "media");
+            if (!rel || !href) {
+                continue;
+            }
+
+            if (has_token(rel->value, "stylesheet") && !has_token(rel->value, "alternate") &&
+                (!media || iequals(media->value, "all") || iequals(media->value, "screen"))) {
+                append_link(links, href->value, "preload", "style", crossorigin);
+            } else if (has_token(rel->value, "modulepreload")) {
+                append_link(links, href->value, "modulepreload", {}, crossorigin);
+            } else if (has_token(rel->value, "preload") && as) {
+                if (iequals(as->value, "font")) {
+                    append_link(links, href->value, "preload", "font", crossorigin ? crossorigin : &ANONYMOUS);
+                } else if (iequals(as->value, "style") || iequals(as->value, "script")) {
+                    append_link(links, href->value, "preload", iequals(as->value, "style") ? "style" : "script",
+                                crossorigin);
+                }
+            }
+        }
+
+        if (links.size() != length) {
+            ++count;
+        }
+    }
+
+    return links;
+}
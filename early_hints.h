@@ -0,0 +1,16 @@
+#ifndef EARLY_HINTS_H
+#define EARLY_HINTS_H
+
+#include <string>
+#include <string_view>
+
+// Link header lines that preload what an HTML page needs before it can render: the
+// stylesheets, scripts and fonts its <head> refers to, in document order, e.g.
+// "Link: </app.css>; rel=preload; as=style\r\n". Empty when there are none.
+//
+// Pages are scanned when they are cached; the lines then go out in a 103 Early Hints
+// response ahead of the page and again with it, so the browser fetches them while the
+// document is still arriving.
+std::string preload_links(std::string_view html);
+
+#endif // EARLY_HINTS_H
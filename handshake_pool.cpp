@@ -0,0 +1,86 @@
+#include "handshake_pool.h"
+
+#include <algorithm>
+
+HandshakePool::HandshakePool(const size_t threads, const size_t capacity, Poller& poller) :
+    capacity(capacity),
+    poller(poller) {
+    for (size_t i = 0; i < threads; ++i) {
+        this->threads.emplace_back(&HandshakePool::run, this);
+    }
+}
+
+HandshakePool::~HandshakePool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+        queue.clear();
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void HandshakePool::admit() {
+    ++in_flight;
+
+    std::lock_guard lock(mutex);
+    metrics.in_flight_peak = std::max(metrics.in_flight_peak, in_flight);
+}
+
+void HandshakePool::release() {
+    --in_flight;
+}
+
+void HandshakePool::submit(const socket_t socket, std::function<void()> step) {
+    {
+        std::lock_guard lock(mutex);
+        queue.push_back({socket, std::move(step), clock::now()});
+        metrics.queue_peak = std::max(metrics.queue_peak, queue.size());
+    }
+    wake.notify_one();
+}
+
+void HandshakePool::take_finished(std::vector<socket_t>& finished) {
+    finished.clear();
+
+    std::lock_guard lock(mutex);
+    finished.swap(this->finished);
+}
+
+HandshakePool::Metrics HandshakePool::take_metrics() {
+    std::lock_guard lock(mutex);
+    const Metrics taken = metrics;
+    metrics = Metrics{};
+    metrics.in_flight_peak = in_flight;
+    return taken;
+}
+
+void HandshakePool::run() {
+    std::unique_lock lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping) {
+            return;
+        }
+
+        Job job = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+
+        const auto start = clock::now();
+        job.step();
+        const auto end = clock::now();
+
+        lock.lock();
+        const auto wait = std::chrono::duration_cast<std::chrono::microseconds>(start - job.queued);
+        ++metrics.steps;
+        metrics.wait += wait;
+        metrics.max_wait = std::max(metrics.max_wait, wait);
+        metrics.work += std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+
+        finished.push_back(job.socket);
+        poller.wake();
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef HANDSHAKE_POOL_H
+#define HANDSHAKE_POOL_H
+
+#include "poller.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs TLS handshake steps on their own threads, so a burst of new connections costs
+// handshake CPU there instead of latency for established connections on the event loop.
+//
+// The loop admits a connection, submits a step whenever its socket is ready and leaves
+// the connection alone until the step comes back from take_finished(); the poller is
+// woken when one does. At most `capacity` connections are admitted at a time, which
+// bounds the queue: the loop stops accepting until one leaves.
+class HandshakePool {
+public:
+    struct Metrics {
+        size_t steps = 0;
+        size_t in_flight_peak = 0;
+        size_t queue_peak = 0;
+        std::chrono::microseconds wait{0};      // Total time steps spent queued.
+        std::chrono::microseconds max_wait{0};
+        std::chrono::microseconds work{0};      // Total time spent running steps.
+    };
+
+    // A zero capacity admits any number of connections.
+    HandshakePool(size_t threads, size_t capacity, Poller& poller);
+    ~HandshakePool();   // Drops the steps still queued and waits for the running ones.
+
+    HandshakePool(const HandshakePool&) = delete;
+    HandshakePool& operator=(const HandshakePool&) = delete;
+
+    // Called on the event loop only.
+    [[nodiscard]] bool has_room() const { return capacity == 0 || in_flight < capacity; }
+    void admit();
+    void release();
+
+    // Queues step for a pool thread; socket is reported by take_finished() after it ran.
+    void submit(socket_t socket, std::function<void()> step);
+    void take_finished(std::vector<socket_t>& finished);
+
+    // Returns the metrics gathered since the last call and starts over.
+    Metrics take_metrics();
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct Job {
+        socket_t socket;
+        std::function<void()> step;
+        clock::time_point queued;
+    };
+
+    void run();
+
+    const size_t capacity;
+    size_t in_flight = 0;
+    Poller& poller;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Job> queue;
+    std::vector<socket_t> finished;
+    Metrics metrics;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+};
+
+#endif // HANDSHAKE_POOL_H
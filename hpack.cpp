@@ -0,0 +1,464 @@
+#include "hpack.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+    const HeaderField STATIC_TABLE[] = {
+        {":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"}, {":path", "/index.html"},
+        {":scheme", "http"}, {":scheme", "https"}, {":status", "200"}, {":status", "204"}, {":status", "206"},
+        {":status", "304"}, {":status", "400"}, {":status", "404"}, {":status", "500"},
+        {"accept-charset", ""}, {"accept-encoding", "gzip, deflate"}, {"accept-language", ""},
+        {"accept-ranges", ""}, {"accept", ""}, {"access-control-allow-origin", ""}, {"age", ""},
+        {"allow", ""}, {"authorization", ""}, {"cache-control", ""}, {"content-disposition", ""},
+        {"content-encoding", ""}, {"content-language", ""}, {"content-length", ""}, {"content-location", ""},
+        {"content-range", ""}, {"content-type", ""}, {"cookie", ""}, {"date", ""}, {"etag", ""},
+        {"expect", ""}, {"expires", ""}, {"from", ""}, {"host", ""}, {"if-match", ""},
+        {"if-modified-since", ""}, {"if-none-match", ""}, {"if-range", ""}, {"if-unmodified-since", ""},
+        {"last-modified", ""}, {"link", ""}, {"location", ""}, {"max-forwards", ""},
+        {"proxy-authenticate", ""}, {"proxy-authorization", ""}, {"range", ""}, {"referer", ""},
+        {"refresh", ""}, {"retry-after", ""}, {"server", ""}, {"set-cookie", ""},
+        {"strict-transport-security", ""}, {"transfer-encoding", ""}, {"user-agent", ""}, {"vary", ""},
+        {"via", ""}, {"www-authenticate", ""},
+    };
+
+    constexpr size_t STATIC_TABLE_SIZE = std::size(STATIC_TABLE);
+
+    // Per-entry overhead in the dynamic table size.
+    constexpr size_t ENTRY_OVERHEAD = 32;
+
+    // Larger integers are malformed; nothing we accept gets anywhere near this.
+    constexpr size_t MAX_INTEGER = 1 << 24;
+
+    struct HuffmanCode {
+        uint32_t bits;
+        uint8_t length;
+    };
+
+    // Codes for bytes 0 to 255 (RFC 7541 appendix B); EOS, the 30 one bits, is not a symbol.
+    constexpr HuffmanCode HUFFMAN_CODES[256] = {
+        {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28},
+        {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28},
+        {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+        {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},
+        {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28},
+        {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+        {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28},
+        {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28}, {0xffffffb, 28},
+        {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+        {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11},
+        {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11},
+        {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+        {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6},
+        {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6},
+        {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+        {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10},
+        {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7},
+        {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+        {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7},
+        {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7},
+        {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+        {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7},
+        {0xfc, 8}, {0x73, 7}, {0xfd, 8}, {0x1ffb, 13},
+        {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+        {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5},
+        {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6},
+        {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+        {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5},
+        {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5},
+        {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+        {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15},
+        {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28},
+        {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},
+        {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23},
+        {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23},
+        {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+        {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23},
+        {0xffffee, 24}, {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23},
+        {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},
+        {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24},
+        {0x3fffda, 22}, {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22},
+        {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+        {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24},
+        {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23},
+        {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+        {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23},
+        {0xfffea, 20}, {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22},
+        {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+        {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19},
+        {0x3fffe7, 22}, {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25},
+        {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},
+        {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25},
+        {0x7fff2, 19}, {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27},
+        {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+        {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26},
+        {0xffffffd, 28}, {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27},
+        {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},
+        {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23},
+        {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25},
+        {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+        {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26},
+        {0x7ffffe7, 27}, {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27},
+        {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+        {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26},
+    };
+
+    constexpr int MAX_CODE_LENGTH = 30;
+
+    // The code is canonical: codes of one length are consecutive numbers, following on
+    // from the shorter ones. So a code is decoded from its length, the first code of that
+    // length and the symbols sorted by code.
+    struct HuffmanDecodeTable {
+        uint32_t first[MAX_CODE_LENGTH + 1] = {};
+        uint32_t count[MAX_CODE_LENGTH + 1] = {};
+        uint32_t offset[MAX_CODE_LENGTH + 1] = {};
+        uint8_t symbols[256] = {};
+    };
+
+    const HuffmanDecodeTable& huffman_decode_table() {
+        static const HuffmanDecodeTable table = [] {
+            HuffmanDecodeTable decode;
+            for (const HuffmanCode& code : HUFFMAN_CODES) {
+                ++decode.count[code.length];
+            }
+
+            uint32_t next_offset = 0;
+            for (int length = 1; length <= MAX_CODE_LENGTH; ++length) {
+                decode.offset[length] = next_offset;
+                next_offset += decode.count[length];
+            }
+
+            uint32_t filled[MAX_CODE_LENGTH + 1] = {};
+            for (size_t symbol = 0; symbol < 256; ++symbol) {
+                const HuffmanCode& code = HUFFMAN_CODES[symbol];
+                if (filled[code.length]++ == 0) {
+                    decode.first[code.length] = code.bits;
+                }
+                decode.symbols[decode.offset[code.length] + code.bits - decode.first[code.length]] =
+                    static_cast<uint8_t>(symbol);
+            }
+            return decode;
+        }();
+        return table;
+    }
+
+    bool huffman_decode(const std::string_view input, std::string& output) {
+        const HuffmanDecodeTable& table = huffman_decode_table();
+        uint32_t code = 0;
+        int length = 0;
+
+        for (const char c : input) {
+            for (int bit = 7; bit >= 0; --bit) {
+                code = code << 1 | ((static_cast<unsigned char>(c) >> bit) & 1);
+                ++length;
+
+                const uint32_t rank = code - table.first[length];
+                if (table.count[length] > 0 && code >= table.first[length] && rank < table.count[length]) {
+                    output.push_back(static_cast<char>(table.symbols[table.offset[length] + rank]));
+                    code = 0;
+                    length = 0;
+                } else if (length == MAX_CODE_LENGTH) {
+                    return false;   // EOS, or no code at all.
+                }
+            }
+        }
+
+        // Padding is at most 7 bits, all ones: a prefix of EOS.
+        return length <= 7 && code == (1u << length) - 1;
+    }
+
+    size_t huffman_length(const std::string_view input) {
+        size_t bits = 0;
+        for (const char c : input) {
+            bits += HUFFMAN_CODES[static_cast<unsigned char>(c)].length;
+        }
+        return (bits + 7) / 8;
+    }
+
+    void huffman_encode(const std::string_view input, std::string& output) {
+        uint64_t pending = 0;
+        int pending_bits = 0;
+
+        for (const char c : input) {
+            const HuffmanCode& code = HUFFMAN_CODES[static_cast<unsigned char>(c)];
+            pending = pending << code.length | code.bits;
+            pending_bits += code.length;
+            while (pending_bits >= 8) {
+                pending_bits -= 8;
+                output.push_back(static_cast<char>(pending >> pending_bits));
+            }
+        }
+
+        if (pending_bits > 0) {
+            const int padding = 8 - pending_bits;
+            output.push_back(static_cast<char>(pending << padding | ((1u << padding) - 1)));
+        }
+    }
+
+    // Integers fill the low prefix_bits of a first byte that carries flags in the rest,
+    // then continue 7 bits per byte when they do not fit.
+    void encode_integer(size_t value, const int prefix_bits, const uint8_t flags, std::string& output) {
+        const size_t limit = (size_t{1} << prefix_bits) - 1;
+        if (value < limit) {
+            output.push_back(static_cast<char>(flags | value));
+            return;
+        }
+
+        output.push_back(static_cast<char>(flags | limit));
+        value -= limit;
+        while (value >= 0x80) {
+            output.push_back(static_cast<char>(0x80 | (value & 0x7f)));
+            value >>= 7;
+        }
+        output.push_back(static_cast<char>(value));
+    }
+
+    bool decode_integer(std::string_view& input, const int prefix_bits, size_t& value) {
+        if (input.empty()) {
+            return false;
+        }
+
+        const size_t limit = (size_t{1} << prefix_bits) - 1;
+        value = static_cast<unsigned char>(input.front()) & limit;
+        input.remove_prefix(1);
+        if (value < limit) {
+            return true;
+        }
+
+        for (int shift = 0; !input.empty(); shift += 7) {
+            // Continuation bytes with no payload bits never grow value, so the shift itself
+            // is bounded: past 21, any further bits would exceed MAX_INTEGER anyway.
+            if (shift > 21) {
+                return false;
+            }
+            const auto byte = static_cast<unsigned char>(input.front());
+            input.remove_prefix(1);
+            value += static_cast<size_t>(byte & 0x7f) << shift;
+            if (value > MAX_INTEGER) {
+                return false;
+            }
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void encode_string(const std::string_view value, std::string& output) {
+        if (const size_t coded = huffman_length(value); coded < value.size()) {
+            encode_integer(coded, 7, 0x80, output);
+            huffman_encode(value, output);
+        } else {
+            encode_integer(value.size(), 7, 0x00, output);
+            output.append(value);
+        }
+    }
+
+    bool decode_string(std::string_view& input, std::string& value) {
+        if (input.empty()) {
+            return false;
+        }
+
+        const bool huffman = static_cast<unsigned char>(input.front()) & 0x80;
+        size_t length = 0;
+        if (!decode_integer(input, 7, length) || length > input.size()) {
+            return false;
+        }
+
+        const std::string_view literal = input.substr(0, length);
+        input.remove_prefix(length);
+
+        value.clear();
+        if (huffman) {
+            return huffman_decode(literal, value);
+        }
+        value.assign(literal);
+        return true;
+    }
+}
+
+const HeaderField* HpackTable::get(const size_t index) const {
+    if (index == 0) {
+        return nullptr;
+    }
+    if (index <= STATIC_TABLE_SIZE) {
+        return &STATIC_TABLE[index - 1];
+    }
+    if (index - STATIC_TABLE_SIZE <= entries.size()) {
+        return &entries[index - STATIC_TABLE_SIZE - 1];
+    }
+    return nullptr;
+}
+
+size_t HpackTable::find(const std::string_view name, const std::string_view value, bool& name_only) const {
+    size_t name_index = 0;
+
+    for (size_t i = 0; i < STATIC_TABLE_SIZE; ++i) {
+        if (STATIC_TABLE[i].name == name) {
+            if (STATIC_TABLE[i].value == value) {
+                name_only = false;
+                return i + 1;
+            }
+            if (name_index == 0) {
+                name_index = i + 1;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].name == name) {
+            if (entries[i].value == value) {
+                name_only = false;
+                return STATIC_TABLE_SIZE + i + 1;
+            }
+            if (name_index == 0) {
+                name_index = STATIC_TABLE_SIZE + i + 1;
+            }
+        }
+    }
+
+    name_only = true;
+    return name_index;
+}
+
+void HpackTable::insert(const std::string_view name, const std::string_view value) {
+    const size_t size = name.size() + value.size() + ENTRY_OVERHEAD;
+
+    // An entry larger than the whole table empties it and is not added.
+    if (size > max_size) {
+        entries.clear();
+        used = 0;
+        return;
+    }
+
+    evict(size);
+    entries.push_front({std::string(name), std::string(value)});
+    used += size;
+}
+
+void HpackTable::resize(const size_t max_size) {
+    this->max_size = max_size;
+    evict(0);
+}
+
+void HpackTable::evict(const size_t needed) {
+    while (!entries.empty() && used + needed > max_size) {
+        used -= entries.back().name.size() + entries.back().value.size() + ENTRY_OVERHEAD;
+        entries.pop_back();
+    }
+}
+
+bool HpackDecoder::decode(std::string_view block, std::vector<HeaderField>& fields, const size_t max_list_size,
+                          bool& oversized) {
+    size_t list_size = 0;
+    bool field_seen = false;
+    oversized = false;
+
+    while (!block.empty()) {
+        const auto first = static_cast<unsigned char>(block.front());
+        HeaderField field;
+
+        if (first & 0x80) {
+            // Indexed field.
+            size_t index = 0;
+            const HeaderField* entry = decode_integer(block, 7, index) ? table.get(index) : nullptr;
+            if (!entry) {
+                return false;
+            }
+            field = *entry;
+        } else if ((first & 0xe0) == 0x20) {
+            // Dynamic table size update, only before the first field.
+            size_t size = 0;
+            if (field_seen || !decode_integer(block, 5, size) || size > HPACK_DEFAULT_TABLE_SIZE) {
+                return false;
+            }
+            table.resize(size);
+            continue;
+        } else {
+            // Literal field: with incremental indexing (01), without indexing (0000) or never
+            // indexed (0001). A zero name index means the name is a literal too.
+            const bool indexing = (first & 0xc0) == 0x40;
+            size_t name_index = 0;
+            if (!decode_integer(block, indexing ? 6 : 4, name_index)) {
+                return false;
+            }
+
+            if (name_index > 0) {
+                const HeaderField* entry = table.get(name_index);
+                if (!entry) {
+                    return false;
+                }
+                field.name = entry->name;
+            } else if (!decode_string(block, field.name)) {
+                return false;
+            }
+
+            if (!decode_string(block, field.value)) {
+                return false;
+            }
+
+            if (indexing) {
+                table.insert(field.name, field.value);
+            }
+        }
+
+        field_seen = true;
+        list_size += field.name.size() + field.value.size() + ENTRY_OVERHEAD;
+        if (list_size > max_list_size) {
+            oversized = true;
+            continue;
+        }
+        fields.push_back(std::move(field));
+    }
+
+    return true;
+}
+
+void HpackEncoder::set_max_table_size(const size_t size) {
+    const size_t capped = std::min(size, HPACK_DEFAULT_TABLE_SIZE);
+    if (capped == table.capacity()) {
+        return;
+    }
+
+    smallest_update = update_pending ? std::min(smallest_update, capped) : capped;
+    update_pending = true;
+    table.resize(capped);
+}
+
+void HpackEncoder::begin(std::string& out) {
+    if (!update_pending) {
+        return;
+    }
+
+    // Entries were evicted at the smallest size, so the peer has to pass through it as well.
+    if (smallest_update < table.capacity()) {
+        encode_integer(smallest_update, 5, 0x20, out);
+    }
+    encode_integer(table.capacity(), 5, 0x20, out);
+    update_pending = false;
+}
+
+void HpackEncoder::encode(const std::string_view name, const std::string_view value, const bool index,
+                          std::string& out) {
+    bool name_only = false;
+    const size_t found = table.find(name, value, name_only);
+
+    if (found > 0 && !name_only) {
+        encode_integer(found, 7, 0x80, out);
+        return;
+    }
+
+    if (index) {
+        encode_integer(found, 6, 0x40, out);
+    } else {
+        encode_integer(found, 4, 0x00, out);
+    }
+    if (found == 0) {
+        encode_string(name, out);
+    }
+    encode_string(value, out);
+
+    if (index) {
+        table.insert(name, value);
+    }
+}
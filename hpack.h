@@ -0,0 +1,78 @@
+#ifndef HPACK_H
+#define HPACK_H
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// HPACK header compression for HTTP/2 (RFC 7541): the static table, a dynamic table per
+// direction, and Huffman coded string literals.
+
+struct HeaderField {
+    std::string name;
+    std::string value;
+};
+
+// Both sides start with, and we never go beyond, this much dynamic table.
+constexpr size_t HPACK_DEFAULT_TABLE_SIZE = 4096;
+
+// Static and dynamic table behind one index space: 1 to 61 are the static entries, the
+// dynamic ones follow, newest first. Dynamic entries count their name and value plus 32
+// bytes, and the oldest ones are evicted to stay within max_size.
+class HpackTable {
+public:
+    explicit HpackTable(size_t max_size) : max_size(max_size) {}
+
+    // Null when index is not in either table.
+    [[nodiscard]] const HeaderField* get(size_t index) const;
+
+    // Index of the field, or failing that of its name (name_only is set then); 0 if neither.
+    [[nodiscard]] size_t find(std::string_view name, std::string_view value, bool& name_only) const;
+
+    void insert(std::string_view name, std::string_view value);
+    void resize(size_t max_size);
+
+    [[nodiscard]] size_t capacity() const { return max_size; }
+
+private:
+    void evict(size_t needed);
+
+    std::deque<HeaderField> entries;    // Newest first.
+    size_t used = 0;
+    size_t max_size;
+};
+
+// Decodes the header blocks a peer sends, keeping its dynamic table in step.
+class HpackDecoder {
+public:
+    // Fields beyond max_list_size bytes (counted like SETTINGS_MAX_HEADER_LIST_SIZE) still
+    // update the dynamic table but are dropped, and oversized is set. Returns false on a
+    // malformed block, which is a connection error: the tables are out of step from then on.
+    bool decode(std::string_view block, std::vector<HeaderField>& fields, size_t max_list_size, bool& oversized);
+
+private:
+    HpackTable table{HPACK_DEFAULT_TABLE_SIZE};
+};
+
+// Encodes the header blocks we send, in the order they go out.
+class HpackEncoder {
+public:
+    // The peer's SETTINGS_HEADER_TABLE_SIZE. Takes effect with the next block.
+    void set_max_table_size(size_t size);
+
+    // Starts a header block in out.
+    void begin(std::string& out);
+
+    // Appends a field to the block. Fields with values that rarely repeat should pass
+    // index = false so they do not push useful entries out of the dynamic table.
+    void encode(std::string_view name, std::string_view value, bool index, std::string& out);
+
+private:
+    HpackTable table{HPACK_DEFAULT_TABLE_SIZE};
+    size_t smallest_update = 0;     // Smallest size since the last block, to be signalled first.
+    bool update_pending = false;
+};
+
+#endif // HPACK_H
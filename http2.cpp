@@ -0,0 +1,774 @@
+#include "http2.h"
+
+#include <algorithm>
+#include <cctype>
+#include <utility>
+
+namespace {
+    // Frame types, including RFC 9218's PRIORITY_UPDATE.
+    constexpr uint8_t DATA = 0x0;
+    constexpr uint8_t HEADERS = 0x1;
+    constexpr uint8_t PRIORITY = 0x2;
+    constexpr uint8_t RST_STREAM = 0x3;
+    constexpr uint8_t SETTINGS = 0x4;
+    constexpr uint8_t PUSH_PROMISE = 0x5;
+    constexpr uint8_t PING = 0x6;
+    constexpr uint8_t GOAWAY = 0x7;
+    constexpr uint8_t WINDOW_UPDATE = 0x8;
+    constexpr uint8_t CONTINUATION = 0x9;
+    constexpr uint8_t PRIORITY_UPDATE = 0x10;
+
+    constexpr uint8_t FLAG_END_STREAM = 0x1;
+    constexpr uint8_t FLAG_ACK = 0x1;
+    constexpr uint8_t FLAG_END_HEADERS = 0x4;
+    constexpr uint8_t FLAG_PADDED = 0x8;
+    constexpr uint8_t FLAG_PRIORITY = 0x20;
+
+    constexpr uint32_t NO_ERROR = 0x0;
+    constexpr uint32_t PROTOCOL_ERROR = 0x1;
+    constexpr uint32_t FLOW_CONTROL_ERROR = 0x3;
+    constexpr uint32_t STREAM_CLOSED = 0x5;
+    constexpr uint32_t FRAME_SIZE_ERROR = 0x6;
+    constexpr uint32_t REFUSED_STREAM = 0x7;
+    constexpr uint32_t COMPRESSION_ERROR = 0x9;
+    constexpr uint32_t ENHANCE_YOUR_CALM = 0xb;
+
+    constexpr uint16_t SETTINGS_HEADER_TABLE_SIZE = 0x1;
+    constexpr uint16_t SETTINGS_ENABLE_PUSH = 0x2;
+    constexpr uint16_t SETTINGS_MAX_CONCURRENT_STREAMS = 0x3;
+    constexpr uint16_t SETTINGS_INITIAL_WINDOW_SIZE = 0x4;
+    constexpr uint16_t SETTINGS_MAX_FRAME_SIZE = 0x5;
+    constexpr uint16_t SETTINGS_MAX_HEADER_LIST_SIZE = 0x6;
+    constexpr uint16_t SETTINGS_NO_RFC7540_PRIORITIES = 0x9;
+
+    constexpr size_t FRAME_HEADER_SIZE = 9;
+    constexpr uint32_t MIN_MAX_FRAME_SIZE = 16384;
+    constexpr uint32_t MAX_MAX_FRAME_SIZE = 16777215;
+    constexpr int64_t MAX_WINDOW = 0x7fffffff;
+    constexpr int64_t DEFAULT_WINDOW = 65535;
+
+    // What we take from clients: frames of the default size, this many streams at once, and
+    // header lists as large as the request headers we accept over HTTP/1.1. The compressed
+    // block, over all its CONTINUATION frames, is capped as well.
+    constexpr uint32_t RECEIVE_MAX_FRAME_SIZE = MIN_MAX_FRAME_SIZE;
+    constexpr uint32_t MAX_CONCURRENT_STREAMS = 100;
+    constexpr uint32_t MAX_HEADER_LIST_SIZE = 16 * 1024;
+    constexpr size_t MAX_HEADER_BLOCK_SIZE = 64 * 1024;
+
+    // DATA frames stay at one full TLS record, however large the client allows, so streams
+    // can take turns at a fine grain.
+    constexpr size_t MAX_DATA_FRAME_SIZE = 16384;
+
+    constexpr uint8_t DEFAULT_URGENCY = 3;
+
+    uint32_t read_u32(const std::string_view bytes) {
+        return static_cast<uint32_t>(static_cast<unsigned char>(bytes[0])) << 24 |
+               static_cast<uint32_t>(static_cast<unsigned char>(bytes[1])) << 16 |
+               static_cast<uint32_t>(static_cast<unsigned char>(bytes[2])) << 8 |
+               static_cast<uint32_t>(static_cast<unsigned char>(bytes[3]));
+    }
+
+    uint16_t read_u16(const std::string_view bytes) {
+        return static_cast<uint16_t>(static_cast<unsigned char>(bytes[0]) << 8 | static_cast<unsigned char>(bytes[1]));
+    }
+
+    void append_u32(std::string& out, const uint32_t value) {
+        out.push_back(static_cast<char>(value >> 24));
+        out.push_back(static_cast<char>(value >> 16));
+        out.push_back(static_cast<char>(value >> 8));
+        out.push_back(static_cast<char>(value));
+    }
+
+    void append_u16(std::string& out, const uint16_t value) {
+        out.push_back(static_cast<char>(value >> 8));
+        out.push_back(static_cast<char>(value));
+    }
+
+    void append_frame_header(std::string& out, const size_t length, const uint8_t type, const uint8_t flags,
+                             const uint32_t stream_id) {
+        out.push_back(static_cast<char>(length >> 16));
+        out.push_back(static_cast<char>(length >> 8));
+        out.push_back(static_cast<char>(length));
+        out.push_back(static_cast<char>(type));
+        out.push_back(static_cast<char>(flags));
+        append_u32(out, stream_id);
+    }
+
+    // Removes the pad length byte and the padding. Returns false if the padding does not fit.
+    bool strip_padding(const uint8_t flags, std::string_view& payload) {
+        if (!(flags & FLAG_PADDED)) {
+            return true;
+        }
+        if (payload.empty()) {
+            return false;
+        }
+
+        const size_t padding = static_cast<unsigned char>(payload.front());
+        if (padding >= payload.size()) {
+            return false;
+        }
+        payload = payload.substr(1, payload.size() - 1 - padding);
+        return true;
+    }
+
+    std::string_view trim(std::string_view value) {
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+            value.remove_prefix(1);
+        }
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+            value.remove_suffix(1);
+        }
+        return value;
+    }
+
+    std::string lower_case(const std::string_view name) {
+        std::string lower(name);
+        for (char& c : lower) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return lower;
+    }
+
+    // Reads urgency and incremental from an RFC 9218 Priority field value such as "u=1, i".
+    // Members it does not know, or cannot parse, leave the values as they are.
+    void parse_priority(std::string_view field, uint8_t& urgency, bool& incremental) {
+        while (!field.empty()) {
+            const size_t comma = field.find(',');
+            std::string_view member = trim(field.substr(0, comma));
+            field.remove_prefix(comma == std::string_view::npos ? field.size() : comma + 1);
+
+            member = member.substr(0, member.find(';'));
+            const size_t equals = member.find('=');
+            const std::string_view key = member.substr(0, equals);
+            const std::string_view value = equals == std::string_view::npos ? "?1" : member.substr(equals + 1);
+
+            if (key == "u" && value.size() == 1 && value[0] >= '0' && value[0] <= '7') {
+                urgency = static_cast<uint8_t>(value[0] - '0');
+            } else if (key == "i" && (value == "?1" || value == "?0")) {
+                incremental = value == "?1";
+            }
+        }
+    }
+
+    // Turns the fields of a request into an HttpRequest. Returns false if the request is
+    // malformed (RFC 9113 section 8.2). Field values cannot smuggle in header lines: CR,
+    // LF and NUL are refused.
+    bool build_request(const std::vector<HeaderField>& fields, HttpRequest& request) {
+        std::string scheme;
+        std::string authority;
+        bool regular_seen = false;
+
+        const auto forbidden = [](const char c) { return c == '\r' || c == '\n' || c == '\0'; };
+
+        for (const HeaderField& field : fields) {
+            const std::string_view name = field.name;
+            if (name.empty() || std::any_of(name.begin(), name.end(), forbidden) ||
+                std::any_of(name.begin(), name.end(), [](const unsigned char c) { return std::isupper(c); }) ||
+                std::any_of(field.value.begin(), field.value.end(), forbidden)) {
+                return false;
+            }
+
+            // Pseudo-header fields, each at most once, come before the regular ones.
+            if (name.front() == ':') {
+                std::string* target = name == ":method" ? &request.method
+                                      : name == ":path" ? &request.target
+                                      : name == ":scheme" ? &scheme
+                                      : name == ":authority" ? &authority
+                                      : nullptr;
+                if (!target || regular_seen || !target->empty()) {
+                    return false;
+                }
+                *target = field.value;
+                continue;
+            }
+            regular_seen = true;
+
+            // HTTP/2 has no connection-specific fields.
+            if (name == "connection" || name == "keep-alive" || name == "proxy-connection" ||
+                name == "transfer-encoding" || name == "upgrade" || (name == "te" && field.value != "trailers")) {
+                return false;
+            }
+
+            request.headers.append(name).append(": ").append(field.value).append("\r\n");
+        }
+
+        // CONNECT, which comes without :scheme and :path, is not served.
+        if (request.method.empty() || request.target.empty() || scheme.empty()) {
+            return false;
+        }
+
+        if (!authority.empty()) {
+            request.headers.insert(0, "host: " + authority + "\r\n");
+        }
+        request.version = "HTTP/2";
+        return true;
+    }
+}
+
+Http2Session::Http2Session() {
+    // No RFC 7540 priority tree: clients that know RFC 9218 send urgencies instead.
+    const std::pair<uint16_t, uint32_t> settings[] = {
+        {SETTINGS_MAX_CONCURRENT_STREAMS, MAX_CONCURRENT_STREAMS},
+        {SETTINGS_MAX_HEADER_LIST_SIZE, MAX_HEADER_LIST_SIZE},
+        {SETTINGS_NO_RFC7540_PRIORITIES, 1},
+    };
+
+    append_frame_header(control, std::size(settings) * 6, SETTINGS, 0, 0);
+    for (const auto& [id, value] : settings) {
+        append_u16(control, id);
+        append_u32(control, value);
+    }
+}
+
+bool Http2Session::receive(std::string& input, std::vector<Request>& requests) {
+    // After a connection error nothing more is read.
+    if (goaway_sent) {
+        input.clear();
+        return false;
+    }
+
+    size_t offset = 0;
+
+    if (!preface_received) {
+        const size_t available = std::min(input.size(), HTTP2_PREFACE.size());
+        if (std::string_view(input).substr(0, available) != HTTP2_PREFACE.substr(0, available)) {
+            input.clear();
+            return connection_error(PROTOCOL_ERROR);
+        }
+        if (available < HTTP2_PREFACE.size()) {
+            return true;
+        }
+        offset = HTTP2_PREFACE.size();
+        preface_received = true;
+    }
+
+    bool ok = true;
+    while (ok && input.size() - offset >= FRAME_HEADER_SIZE) {
+        const std::string_view header = std::string_view(input).substr(offset, FRAME_HEADER_SIZE);
+        const uint32_t length = read_u32(header) >> 8;
+        if (length > RECEIVE_MAX_FRAME_SIZE) {
+            ok = connection_error(FRAME_SIZE_ERROR);
+            break;
+        }
+        if (input.size() - offset - FRAME_HEADER_SIZE < length) {
+            break;
+        }
+
+        const auto type = static_cast<uint8_t>(header[3]);
+        const auto flags = static_cast<uint8_t>(header[4]);
+        const uint32_t stream_id = read_u32(header.substr(5)) & 0x7fffffff;
+        const std::string_view payload = std::string_view(input).substr(offset + FRAME_HEADER_SIZE, length);
+        offset += FRAME_HEADER_SIZE + length;
+
+        ok = handle_frame(type, flags, stream_id, payload, requests);
+    }
+
+    if (ok) {
+        input.erase(0, offset);
+    } else {
+        input.clear();
+    }
+    return ok;
+}
+
+bool Http2Session::handle_frame(const uint8_t type, const uint8_t flags, const uint32_t stream_id,
+                                const std::string_view payload, std::vector<Request>& requests) {
+    // A header block is contiguous: nothing may come between its frames.
+    if (header_stream != 0 && (type != CONTINUATION || stream_id != header_stream)) {
+        return connection_error(PROTOCOL_ERROR);
+    }
+
+    // The client's preface ends with its SETTINGS.
+    if (!settings_received && (type != SETTINGS || (flags & FLAG_ACK))) {
+        return connection_error(PROTOCOL_ERROR);
+    }
+
+    // Streams the client has not opened yet; clients only open odd ones.
+    const bool idle = stream_id > last_stream_id || stream_id % 2 == 0;
+
+    switch (type) {
+        case DATA:
+            return handle_data(flags, stream_id, payload);
+
+        case HEADERS:
+            return handle_headers(flags, stream_id, payload, requests);
+
+        case PRIORITY:
+            if (stream_id == 0) {
+                return connection_error(PROTOCOL_ERROR);
+            }
+            if (payload.size() != 5) {
+                reset_stream(stream_id, FRAME_SIZE_ERROR);
+            } else if ((read_u32(payload) & 0x7fffffff) == stream_id) {
+                // Its dependencies are not used, but a stream cannot depend on itself.
+                reset_stream(stream_id, PROTOCOL_ERROR);
+            }
+            return true;
+
+        case RST_STREAM:
+            if (stream_id == 0 || idle) {
+                return connection_error(PROTOCOL_ERROR);
+            }
+            if (payload.size() != 4) {
+                return connection_error(FRAME_SIZE_ERROR);
+            }
+            streams.erase(stream_id);
+            return true;
+
+        case SETTINGS:
+            return handle_settings(flags, stream_id, payload);
+
+        case PUSH_PROMISE:
+            return connection_error(PROTOCOL_ERROR);
+
+        case PING:
+            if (stream_id != 0) {
+                return connection_error(PROTOCOL_ERROR);
+            }
+            if (payload.size() != 8) {
+                return connection_error(FRAME_SIZE_ERROR);
+            }
+            if (!(flags & FLAG_ACK)) {
+                append_frame_header(control, payload.size(), PING, FLAG_ACK, 0);
+                control.append(payload);
+            }
+            return true;
+
+        case GOAWAY:
+            if (stream_id != 0) {
+                return connection_error(PROTOCOL_ERROR);
+            }
+            if (payload.size() < 8) {
+                return connection_error(FRAME_SIZE_ERROR);
+            }
+            goaway_received = true;
+            return true;
+
+        case WINDOW_UPDATE:
+            return handle_window_update(stream_id, payload);
+
+        case CONTINUATION:
+            if (header_stream == 0) {
+                return connection_error(PROTOCOL_ERROR);
+            }
+            if (header_block.size() + payload.size() > MAX_HEADER_BLOCK_SIZE) {
+                return connection_error(ENHANCE_YOUR_CALM);
+            }
+            header_block.append(payload);
+            return !(flags & FLAG_END_HEADERS) || finish_header_block(requests);
+
+        case PRIORITY_UPDATE: {
+            if (stream_id != 0) {
+                return connection_error(PROTOCOL_ERROR);
+            }
+            if (payload.size() < 4) {
+                return connection_error(FRAME_SIZE_ERROR);
+            }
+            const uint32_t prioritized = read_u32(payload) & 0x7fffffff;
+            if (prioritized == 0) {
+                return connection_error(PROTOCOL_ERROR);
+            }
+
+            // The new signal replaces the old one as a whole.
+            if (const auto it = streams.find(prioritized); it != streams.end()) {
+                it->second.urgency = DEFAULT_URGENCY;
+                it->second.incremental = false;
+                parse_priority(payload.substr(4), it->second.urgency, it->second.incremental);
+            }
+            return true;
+        }
+
+        default:
+            // Unknown frame types are ignored.
+            return true;
+    }
+}
+
+bool Http2Session::handle_data(const uint8_t flags, const uint32_t stream_id, std::string_view payload) {
+    if (stream_id == 0 || stream_id > last_stream_id || stream_id % 2 == 0) {
+        return connection_error(PROTOCOL_ERROR);
+    }
+
+    // The whole frame, padding included, counts against the window.
+    const auto length = static_cast<uint32_t>(payload.size());
+    receive_window -= length;
+    if (receive_window < 0) {
+        return connection_error(FLOW_CONTROL_ERROR);
+    }
+    received_unacknowledged += length;
+
+    if (!strip_padding(flags, payload)) {
+        return connection_error(PROTOCOL_ERROR);
+    }
+
+    // Request bodies are not used. Their window goes straight back, so the client is not
+    // stuck before it reads the response; frames for streams we closed are dropped.
+    if (const auto it = streams.find(stream_id); it != streams.end()) {
+        if (it->second.remote_closed) {
+            reset_stream(stream_id, STREAM_CLOSED);
+        } else if (flags & FLAG_END_STREAM) {
+            it->second.remote_closed = true;
+        } else if (length > 0) {
+            append_frame_header(control, 4, WINDOW_UPDATE, 0, stream_id);
+            append_u32(control, length);
+        }
+    }
+
+    if (received_unacknowledged >= DEFAULT_WINDOW / 2) {
+        append_frame_header(control, 4, WINDOW_UPDATE, 0, 0);
+        append_u32(control, received_unacknowledged);
+        receive_window += received_unacknowledged;
+        received_unacknowledged = 0;
+    }
+    return true;
+}
+
+bool Http2Session::handle_headers(const uint8_t flags, const uint32_t stream_id, std::string_view payload,
+                                  std::vector<Request>& requests) {
+    if (stream_id == 0 || stream_id % 2 == 0 || !strip_padding(flags, payload)) {
+        return connection_error(PROTOCOL_ERROR);
+    }
+
+    header_bad_priority = false;
+    if (flags & FLAG_PRIORITY) {
+        if (payload.size() < 5) {
+            return connection_error(FRAME_SIZE_ERROR);
+        }
+        header_bad_priority = (read_u32(payload) & 0x7fffffff) == stream_id;
+        payload.remove_prefix(5);
+    }
+
+    // A lower stream id can only be trailers for a stream that is still open.
+    header_opens_stream = stream_id > last_stream_id;
+    if (header_opens_stream) {
+        last_stream_id = stream_id;
+    }
+
+    header_stream = stream_id;
+    header_end_stream = flags & FLAG_END_STREAM;
+    header_block.assign(payload);
+
+    return !(flags & FLAG_END_HEADERS) || finish_header_block(requests);
+}
+
+bool Http2Session::finish_header_block(std::vector<Request>& requests) {
+    const uint32_t stream_id = header_stream;
+    header_stream = 0;
+
+    // Every block is decoded, even for a stream that is refused, to keep the table in step.
+    std::vector<HeaderField> fields;
+    bool oversized = false;
+    const bool decoded = decoder.decode(header_block, fields, MAX_HEADER_LIST_SIZE, oversized);
+    header_block.clear();
+    if (!decoded) {
+        return connection_error(COMPRESSION_ERROR);
+    }
+
+    if (!header_opens_stream) {
+        const auto it = streams.find(stream_id);
+        if (it == streams.end()) {
+            if (!header_end_stream) {
+                return connection_error(STREAM_CLOSED);
+            }
+            return true;
+        }
+        if (it->second.remote_closed || !header_end_stream) {
+            reset_stream(stream_id, PROTOCOL_ERROR);
+        } else {
+            it->second.remote_closed = true;
+        }
+        return true;
+    }
+
+    if (header_bad_priority) {
+        reset_stream(stream_id, PROTOCOL_ERROR);
+        return true;
+    }
+
+    if (streams.size() >= MAX_CONCURRENT_STREAMS) {
+        reset_stream(stream_id, REFUSED_STREAM);
+        return true;
+    }
+
+    Request request{stream_id, {}};
+    if (!oversized && !build_request(fields, request.request)) {
+        reset_stream(stream_id, PROTOCOL_ERROR);
+        return true;
+    }
+
+    Stream& stream = streams[stream_id];
+    stream.send_window = initial_window;
+    stream.remote_closed = header_end_stream;
+
+    if (oversized) {
+        respond(stream_id, 431, "Content-Length: 0\r\n", {}, nullptr);
+        return true;
+    }
+
+    parse_priority(request.request.header("priority"), stream.urgency, stream.incremental);
+    requests.push_back(std::move(request));
+    return true;
+}
+
+bool Http2Session::handle_settings(const uint8_t flags, const uint32_t stream_id, std::string_view payload) {
+    if (stream_id != 0) {
+        return connection_error(PROTOCOL_ERROR);
+    }
+
+    if (flags & FLAG_ACK) {
+        return payload.empty() || connection_error(FRAME_SIZE_ERROR);
+    }
+
+    if (payload.size() % 6 != 0) {
+        return connection_error(FRAME_SIZE_ERROR);
+    }
+
+    for (; !payload.empty(); payload.remove_prefix(6)) {
+        const uint32_t value = read_u32(payload.substr(2));
+
+        switch (read_u16(payload)) {
+            case SETTINGS_HEADER_TABLE_SIZE:
+                encoder.set_max_table_size(value);
+                break;
+
+            case SETTINGS_ENABLE_PUSH:
+                if (value > 1) {
+                    return connection_error(PROTOCOL_ERROR);
+                }
+                break;
+
+            case SETTINGS_INITIAL_WINDOW_SIZE: {
+                if (value > MAX_WINDOW) {
+                    return connection_error(FLOW_CONTROL_ERROR);
+                }
+
+                // Open streams move by the difference.
+                const int64_t delta = static_cast<int64_t>(value) - initial_window;
+                for (auto& [id, stream] : streams) {
+                    stream.send_window += delta;
+                    if (stream.send_window > MAX_WINDOW) {
+                        return connection_error(FLOW_CONTROL_ERROR);
+                    }
+                }
+                initial_window = value;
+                break;
+            }
+
+            case SETTINGS_MAX_FRAME_SIZE:
+                if (value < MIN_MAX_FRAME_SIZE || value > MAX_MAX_FRAME_SIZE) {
+                    return connection_error(PROTOCOL_ERROR);
+                }
+                max_frame_size = value;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    settings_received = true;
+    append_frame_header(control, 0, SETTINGS, FLAG_ACK, 0);
+    return true;
+}
+
+bool Http2Session::handle_window_update(const uint32_t stream_id, const std::string_view payload) {
+    if (payload.size() != 4) {
+        return connection_error(FRAME_SIZE_ERROR);
+    }
+
+    const uint32_t increment = read_u32(payload) & 0x7fffffff;
+
+    if (stream_id == 0) {
+        if (increment == 0) {
+            return connection_error(PROTOCOL_ERROR);
+        }
+        send_window += increment;
+        return send_window <= MAX_WINDOW || connection_error(FLOW_CONTROL_ERROR);
+    }
+
+    if (stream_id > last_stream_id || stream_id % 2 == 0) {
+        return connection_error(PROTOCOL_ERROR);
+    }
+
+    const auto it = streams.find(stream_id);
+    if (it == streams.end()) {
+        return true;
+    }
+
+    if (increment == 0) {
+        reset_stream(stream_id, PROTOCOL_ERROR);
+        return true;
+    }
+
+    it->second.send_window += increment;
+    if (it->second.send_window > MAX_WINDOW) {
+        reset_stream(stream_id, FLOW_CONTROL_ERROR);
+    }
+    return true;
+}
+
+bool Http2Session::connection_error(const uint32_t code) {
+    append_frame_header(control, 8, GOAWAY, 0, 0);
+    append_u32(control, last_stream_id);
+    append_u32(control, code);
+    goaway_sent = true;
+    return false;
+}
+
+void Http2Session::reset_stream(const uint32_t stream_id, const uint32_t code) {
+    append_frame_header(control, 4, RST_STREAM, 0, stream_id);
+    append_u32(control, code);
+    streams.erase(stream_id);
+}
+
+// Our side of the stream is done. A client still sending a request body is told to stop.
+void Http2Session::close_local(const std::map<uint32_t, Stream>::iterator it) {
+    if (!it->second.remote_closed) {
+        append_frame_header(control, 4, RST_STREAM, 0, it->first);
+        append_u32(control, NO_ERROR);
+    }
+    streams.erase(it);
+}
+
+void Http2Session::inform(const uint32_t stream_id, const int status, const std::string_view headers) {
+    const auto it = streams.find(stream_id);
+    if (it == streams.end() || it->second.responded) {
+        return;
+    }
+
+    queue_headers(stream_id, status, headers, false);
+}
+
+void Http2Session::respond(const uint32_t stream_id, const int status, const std::string_view headers,
+                           const std::string_view body, std::shared_ptr<const void> storage) {
+    const auto it = streams.find(stream_id);
+    if (it == streams.end() || it->second.responded) {
+        return;
+    }
+
+    const bool end_stream = body.empty();
+    queue_headers(stream_id, status, headers, end_stream);
+
+    Stream& stream = it->second;
+    stream.responded = true;
+    stream.body = body;
+    stream.storage = std::move(storage);
+
+    if (end_stream) {
+        close_local(it);
+    }
+}
+
+void Http2Session::queue_headers(const uint32_t stream_id, const int status, const std::string_view headers,
+                                 const bool end_stream) {
+    std::string block;
+    encoder.begin(block);
+    encoder.encode(":status", std::to_string(status), true, block);
+
+    // Header lines become lower-case fields, without the connection-specific ones.
+    std::string_view remaining = headers;
+    while (!remaining.empty()) {
+        const size_t line_end = remaining.find("\r\n");
+        const std::string_view line = remaining.substr(0, line_end);
+        remaining.remove_prefix(line_end == std::string_view::npos ? remaining.size() : line_end + 2);
+
+        const size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+
+        const std::string name = lower_case(trim(line.substr(0, colon)));
+        if (name == "connection" || name == "keep-alive" || name == "transfer-encoding") {
+            continue;
+        }
+
+        // Lengths differ from one response to the next, so indexing them would only churn the table.
+        encoder.encode(name, trim(line.substr(colon + 1)), name != "content-length", block);
+    }
+
+    // A block larger than a frame continues in CONTINUATION frames.
+    std::string_view rest = block;
+    uint8_t type = HEADERS;
+    do {
+        const std::string_view fragment = rest.substr(0, max_frame_size);
+        rest.remove_prefix(fragment.size());
+
+        uint8_t flags = rest.empty() ? FLAG_END_HEADERS : 0;
+        if (type == HEADERS && end_stream) {
+            flags |= FLAG_END_STREAM;
+        }
+        append_frame_header(control, fragment.size(), type, flags, stream_id);
+        control.append(fragment);
+        type = CONTINUATION;
+    } while (!rest.empty());
+}
+
+// The most urgent streams go first. Among equally urgent ones, a non-incremental response
+// goes out whole, lowest stream first; incremental ones take turns a frame at a time.
+std::map<uint32_t, Http2Session::Stream>::iterator Http2Session::next_stream() {
+    auto best = streams.end();
+
+    for (auto it = streams.begin(); it != streams.end(); ++it) {
+        const Stream& stream = it->second;
+        if (stream.body.empty() || stream.send_window <= 0) {
+            continue;
+        }
+
+        if (best == streams.end() || stream.urgency < best->second.urgency) {
+            best = it;
+        } else if (stream.urgency == best->second.urgency && best->second.incremental) {
+            if (!stream.incremental || (best->first <= last_incremental && it->first > last_incremental)) {
+                best = it;
+            }
+        }
+    }
+
+    if (best != streams.end() && best->second.incremental) {
+        last_incremental = best->first;
+    }
+    return best;
+}
+
+void Http2Session::write(OutputQueue& output, const size_t limit) {
+    if (!control.empty()) {
+        output.push(std::move(control));
+        control.clear();
+    }
+
+    while (output.size() < limit && send_window > 0) {
+        const auto it = next_stream();
+        if (it == streams.end()) {
+            break;
+        }
+
+        Stream& stream = it->second;
+        const size_t length = std::min({stream.body.size(), MAX_DATA_FRAME_SIZE, static_cast<size_t>(send_window),
+                                        static_cast<size_t>(stream.send_window)});
+        const bool last = length == stream.body.size();
+
+        std::string header;
+        append_frame_header(header, length, DATA, last ? FLAG_END_STREAM : 0, it->first);
+        output.push(std::move(header));
+        output.push(stream.body.substr(0, length), stream.storage);
+
+        stream.body.remove_prefix(length);
+        stream.send_window -= static_cast<int64_t>(length);
+        send_window -= static_cast<int64_t>(length);
+
+        if (last) {
+            close_local(it);
+        }
+    }
+
+    // Resets for streams that just ended.
+    if (!control.empty()) {
+        output.push(std::move(control));
+        control.clear();
+    }
+}
+
+bool Http2Session::has_pending() const {
+    return std::any_of(streams.begin(), streams.end(), [](const auto& entry) {
+        return !entry.second.body.empty();
+    });
+}
@@ -0,0 +1,113 @@
+#ifndef HTTP2_H
+#define HTTP2_H
+
+#include "hpack.h"
+#include "http_request.h"
+#include "output_queue.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// What an HTTP/2 client sends first (RFC 9113 section 3.4). On plain HTTP, a client that
+// knows the server speaks HTTP/2 starts with it instead of an HTTP/1.1 request.
+constexpr std::string_view HTTP2_PREFACE = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+// Server side of one HTTP/2 connection (RFC 9113): frames, stream states and flow control,
+// HPACK for header blocks, and RFC 9218 priorities to order the responses.
+//
+// receive() takes the bytes read from the connection and hands back the requests that
+// completed; each is answered through respond(). write() then queues frames on the
+// connection's output: control frames and response headers first, then DATA from the
+// most urgent streams as far as flow control allows. Response bodies stay in place,
+// pinned by their storage, until a DATA frame carries them out.
+class Http2Session {
+public:
+    struct Request {
+        uint32_t stream_id;
+        HttpRequest request;    // Version "HTTP/2"; headers has host from :authority and the regular fields.
+    };
+
+    Http2Session();     // Queues the server's SETTINGS.
+
+    Http2Session(const Http2Session&) = delete;
+    Http2Session& operator=(const Http2Session&) = delete;
+
+    // Parses the complete frames at the front of input and erases them. Returns false on a
+    // connection error; a GOAWAY is queued then, and the connection closes once it is written.
+    bool receive(std::string& input, std::vector<Request>& requests);
+
+    // Answers a request. headers are "Name: value\r\n" lines; an empty body ends the stream
+    // with the headers, as for HEAD. Streams the client reset meanwhile are skipped.
+    void respond(uint32_t stream_id, int status, std::string_view headers, std::string_view body,
+                 std::shared_ptr<const void> storage);
+
+    // Sends an interim (1xx) response, such as 103 Early Hints, ahead of the final one.
+    void inform(uint32_t stream_id, int status, std::string_view headers);
+
+    // Queues frames until output holds limit bytes or nothing more may be sent yet.
+    void write(OutputQueue& output, size_t limit);
+
+    // Whether a response is still partly unqueued, e.g. behind a closed flow control window.
+    [[nodiscard]] bool has_pending() const;
+
+    // Whether the client said goodbye (GOAWAY) and every stream is done.
+    [[nodiscard]] bool finished() const { return goaway_received && streams.empty(); }
+
+private:
+    struct Stream {
+        int64_t send_window = 0;
+        uint8_t urgency = 3;            // RFC 9218: 0 is the most urgent, 3 the default.
+        bool incremental = false;       // Useful in pieces, so it may share the connection.
+        bool remote_closed = false;     // The client ended its side.
+        bool responded = false;
+        std::string_view body;          // Not yet queued.
+        std::shared_ptr<const void> storage;
+    };
+
+    bool handle_frame(uint8_t type, uint8_t flags, uint32_t stream_id, std::string_view payload,
+                      std::vector<Request>& requests);
+    bool handle_data(uint8_t flags, uint32_t stream_id, std::string_view payload);
+    bool handle_headers(uint8_t flags, uint32_t stream_id, std::string_view payload, std::vector<Request>& requests);
+    bool handle_settings(uint8_t flags, uint32_t stream_id, std::string_view payload);
+    bool handle_window_update(uint32_t stream_id, std::string_view payload);
+    bool finish_header_block(std::vector<Request>& requests);
+
+    bool connection_error(uint32_t code);
+    void reset_stream(uint32_t stream_id, uint32_t code);
+    void queue_headers(uint32_t stream_id, int status, std::string_view headers, bool end_stream);
+    void close_local(std::map<uint32_t, Stream>::iterator it);
+    std::map<uint32_t, Stream>::iterator next_stream();
+
+    std::map<uint32_t, Stream> streams;
+    uint32_t last_stream_id = 0;        // Highest stream the client opened.
+    uint32_t last_incremental = 0;      // Round robin position among incremental streams.
+
+    bool preface_received = false;
+    bool settings_received = false;
+    bool goaway_sent = false;
+    bool goaway_received = false;
+
+    // A header block being collected from HEADERS and CONTINUATION frames.
+    uint32_t header_stream = 0;
+    bool header_opens_stream = false;
+    bool header_end_stream = false;
+    bool header_bad_priority = false;
+    std::string header_block;
+
+    // Flow control: what the client lets us send, and what we still take from it.
+    int64_t send_window = 65535;
+    int64_t initial_window = 65535;
+    int64_t receive_window = 65535;
+    uint32_t received_unacknowledged = 0;
+    uint32_t max_frame_size = 16384;
+
+    HpackDecoder decoder;
+    HpackEncoder encoder;
+    std::string control;                // Frames that go out ahead of DATA.
+};
+
+#endif // HTTP2_H
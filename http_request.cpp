@@ -0,0 +1,123 @@
+#include "http_request.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace {
+    bool iequals(const std::string_view a, const std::string_view b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const char x, const char y) {
+            return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+        });
+    }
+
+    std::string_view trim(std::string_view value) {
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+            value.remove_prefix(1);
+        }
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+            value.remove_suffix(1);
+        }
+        return value;
+    }
+
+    // Whether a list item's parameters carry a weight of zero ("q=0", "q=0.000"), which
+    // refuses the item rather than accepting it.
+    bool zero_weight(std::string_view parameters) {
+        while (!parameters.empty()) {
+            const size_t semicolon = parameters.find(';');
+            const std::string_view parameter = trim(parameters.substr(0, semicolon));
+            parameters.remove_prefix(semicolon == std::string_view::npos ? parameters.size() : semicolon + 1);
+
+            const size_t equals = parameter.find('=');
+            if (equals == std::string_view::npos || !iequals(trim(parameter.substr(0, equals)), "q")) {
+                continue;
+            }
+
+            const std::string_view weight = trim(parameter.substr(equals + 1));
+            return !weight.empty() && weight.front() == '0' &&
+                   weight.find_first_not_of("0.", 1) == std::string_view::npos;
+        }
+        return false;
+    }
+}
+
+std::string_view HttpRequest::header(const std::string_view name) const {
+    std::string_view remaining = headers;
+
+    while (!remaining.empty()) {
+        const size_t line_end = remaining.find("\r\n");
+        const std::string_view line = remaining.substr(0, line_end);
+        remaining.remove_prefix(line_end == std::string_view::npos ? remaining.size() : line_end + 2);
+
+        const size_t colon = line.find(':');
+        if (colon != std::string_view::npos && iequals(trim(line.substr(0, colon)), name)) {
+            return trim(line.substr(colon + 1));
+        }
+    }
+
+    return {};
+}
+
+bool HttpRequest::header_has_token(const std::string_view name, const std::string_view token) const {
+    std::string_view list = header(name);
+
+    while (!list.empty()) {
+        const size_t comma = list.find(',');
+        std::string_view item = trim(list.substr(0, comma));
+        item = item.substr(0, item.find(';'));
+
+        if (iequals(trim(item), token)) {
+            return true;
+        }
+
+        list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+    }
+
+    return false;
+}
+
+bool HttpRequest::header_accepts(const std::string_view name, const std::string_view token) const {
+    std::string_view list = header(name);
+    bool wildcard = false;
+
+    while (!list.empty()) {
+        const size_t comma = list.find(',');
+        const std::string_view item = trim(list.substr(0, comma));
+        list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+
+        const size_t semicolon = item.find(';');
+        const std::string_view value = trim(item.substr(0, semicolon));
+        const bool accepted = semicolon == std::string_view::npos || !zero_weight(item.substr(semicolon + 1));
+
+        // A named token outweighs the wildcard, wherever each appears.
+        if (iequals(value, token)) {
+            return accepted;
+        }
+        if (value == "*") {
+            wildcard = accepted;
+        }
+    }
+
+    return wildcard;
+}
+
+bool parse_http_request(const std::string_view head, HttpRequest& request) {
+    const size_t line_end = head.find("\r\n");
+    if (line_end == std::string_view::npos) {
+        return false;
+    }
+
+    const std::string_view line = head.substr(0, line_end);
+    const size_t method_end = line.find(' ');
+    const size_t target_end = line.find(' ', method_end + 1);
+    if (method_end == std::string_view::npos || target_end == std::string_view::npos) {
+        return false;
+    }
+
+    request.method = line.substr(0, method_end);
+    request.target = line.substr(method_end + 1, target_end - method_end - 1);
+    request.version = line.substr(target_end + 1);
+    request.headers = head.substr(line_end + 2);
+
+    return !request.method.empty() && !request.target.empty() && request.version.starts_with("HTTP/");
+}
@@ -0,0 +1,28 @@
+#ifndef HTTP_REQUEST_H
+#define HTTP_REQUEST_H
+
+#include <string>
+#include <string_view>
+
+// Request line and header block of an HTTP/1.x request, as received.
+struct HttpRequest {
+    std::string method;
+    std::string target;
+    std::string version;
+    std::string headers;    // Header lines after the request line, each ending in CRLF.
+
+    // First value of the named header (case-insensitive), or empty if absent.
+    [[nodiscard]] std::string_view header(std::string_view name) const;
+
+    // Whether a comma-separated header list contains token (case-insensitive).
+    [[nodiscard]] bool header_has_token(std::string_view name, std::string_view token) const;
+
+    // Whether a weighted list like Accept-Encoding accepts token: listed, or covered by "*",
+    // without q=0.
+    [[nodiscard]] bool header_accepts(std::string_view name, std::string_view token) const;
+};
+
+// Parses a header block terminated by CRLF CRLF. Returns false if the request line is malformed.
+bool parse_http_request(std::string_view head, HttpRequest& request);
+
+#endif // HTTP_REQUEST_H
@@ -1,20 +1,19 @@
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <vector>
+#include "config.h"
 #include "server.h"
-#include "yaml/Yaml.hpp"
-
-namespace std {
-    class invalid_argument;
-}
+#include "archive.h"
 
 int main(const int argc, char* argv[]) {
-    std::string config_file = "config.yaml";
-    int server_port = 80;
-    bool https = false;
+    if (argc >= 2 && std::string(argv[1]) == "pack") {
+        const char* www_dir = argc >= 3 ? argv[2] : "www";
+        const char* archive_file = argc >= 4 ? argv[3] : "www.jpk";
+        return archive_pack(www_dir, archive_file) ? 0 : 1;
+    }
 
-    auto cert_path = "server.crt";
-    auto key_path = "server.key";
+    std::string config_file = "config.yaml";
 
     for (int i = 1; i < argc; ++i) {
         if (std::string arg = argv[i]; (arg == "--config" || arg == "-c") && i + 1 < argc) {
@@ -22,41 +21,61 @@ int main(const int argc, char* argv[]) {
         }
     }
 
-    if (!std::ifstream(config_file)) {
-        std::cout << "Configuration file not found, continuing with default settings.\n";
-    } else {
-        Yaml::Node root;
-        Yaml::Parse(root, config_file.c_str());
-        if (root["port"].IsScalar()) {
-            try {
-                server_port = std::stoi(root["port"].As<std::string>());
-                https = root["https"].As<bool>(false);
-                cert_path = const_cast<char*>(root["cert"].As<std::string>("server.crt").c_str());
-                key_path = const_cast<char*>(root["key"].As<std::string>("server.key").c_str());
-            }
-            catch (const std::exception& e) {
-                std::cerr << "Error parsing port number: " << e.what() << "\n";
+    // Command line settings override the file, on every reload as well.
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    // Only the first load, at startup, runs on defaults without a file. A reload after the
+    // file went away keeps the running settings rather than resetting them.
+    const auto load = [config_file, args, started = false]() mutable -> std::shared_ptr<const Config> {
+        Config config;
+        const bool startup = !started;
+        started = true;
+
+        if (!std::ifstream(config_file)) {
+            if (!startup) {
+                std::cerr << "Configuration file " << config_file << " not found." << std::endl;
+                return nullptr;
             }
+            std::cout << "Configuration file not found, continuing with default settings.\n";
+        } else if (!load_config(config_file, config)) {
+            std::cerr << "Invalid configuration in " << config_file << "." << std::endl;
+            return nullptr;
         }
-    }
 
-    for (int i = 1; i < argc; ++i) {
-        if (std::string arg = argv[i]; (arg == "--port" || arg == "-p") && i + 1 < argc) {
-            server_port = std::stoi(argv[++i]);
-        }
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            const bool has_value = i + 1 < args.size();
 
-        if (std::string arg = argv[i]; (arg == "--https" || arg == "-s") && i + 1 < argc) {
-            https = (std::string(argv[++i]) == "true" || std::string(argv[i]) == "1");
-        }
+            if ((arg == "--port" || arg == "-p") && has_value) {
+                try {
+                    config.port = std::stoi(args[++i]);
+                }
+                catch (const std::exception&) {
+                    std::cerr << "Invalid port number: " << args[i] << std::endl;
+                    return nullptr;
+                }
+            }
 
-        if (std::string arg = argv[i]; (arg == "--cert" || arg == "-c") && i + 1 < argc) {
-            cert_path = argv[++i];
-        }
+            if ((arg == "--https" || arg == "-s") && has_value) {
+                config.https = (args[i + 1] == "true" || args[i + 1] == "1");
+                ++i;
+            }
+
+            if ((arg == "--cert" || arg == "-c") && has_value) {
+                config.cert_path = args[++i];
+            }
 
-        if (std::string arg = argv[i]; (arg == "--key" || arg == "-k") && i + 1 < argc) {
-            key_path = argv[++i];
+            if ((arg == "--key" || arg == "-k") && has_value) {
+                config.key_path = args[++i];
+            }
+
+            if ((arg == "--archive" || arg == "-a") && has_value) {
+                config.archive_path = args[++i];
+            }
         }
-    }
 
-    return server(server_port, https, cert_path, key_path);
+        return std::make_shared<const Config>(std::move(config));
+    };
+
+    return server(load);
 }
@@ -0,0 +1,190 @@
+#include "ocsp_stapler.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include <openssl/ocsp.h>
+
+namespace {
+    using system_clock = std::chrono::system_clock;
+
+    // How often the files are checked, and how long before expiry a stale one is reported.
+    constexpr std::chrono::seconds REFRESH_INTERVAL{60};
+    constexpr std::chrono::hours EXPIRY_WARNING{24};
+
+    // Reads a DER OCSP response and checks that it vouches for certificate (matched by
+    // serial number) and has not expired. Returns the bytes and sets next_update, or
+    // reports the problem and returns null.
+    std::shared_ptr<const std::string> read_response(const std::string& path, X509* certificate,
+                                                     system_clock::time_point& next_update) {
+        std::ifstream file(path, std::ios::binary);
+        std::string der((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (!file.good() && !file.eof()) {
+            std::cerr << "Unable to read OCSP response " << path << std::endl;
+            return nullptr;
+        }
+
+        const auto* input = reinterpret_cast<const unsigned char*>(der.data());
+        const std::unique_ptr<OCSP_RESPONSE, decltype(&OCSP_RESPONSE_free)> response(
+            d2i_OCSP_RESPONSE(nullptr, &input, static_cast<long>(der.size())), OCSP_RESPONSE_free);
+        if (!response || OCSP_response_status(response.get()) != OCSP_RESPONSE_STATUS_SUCCESSFUL) {
+            std::cerr << "OCSP response " << path << " is not a successful OCSP response" << std::endl;
+            return nullptr;
+        }
+
+        const std::unique_ptr<OCSP_BASICRESP, decltype(&OCSP_BASICRESP_free)> basic(
+            OCSP_response_get1_basic(response.get()), OCSP_BASICRESP_free);
+        if (!basic) {
+            std::cerr << "OCSP response " << path << " has no basic response" << std::endl;
+            return nullptr;
+        }
+
+        for (int i = 0; i < OCSP_resp_count(basic.get()); ++i) {
+            OCSP_SINGLERESP* single = OCSP_resp_get0(basic.get(), i);
+
+            ASN1_INTEGER* serial = nullptr;
+            OCSP_id_get0_info(nullptr, nullptr, nullptr, &serial, const_cast<OCSP_CERTID*>(OCSP_SINGLERESP_get0_id(single)));
+            if (!serial || ASN1_INTEGER_cmp(serial, X509_get0_serialNumber(certificate)) != 0) {
+                continue;
+            }
+
+            int reason = 0;
+            ASN1_GENERALIZEDTIME* revoked_at = nullptr;
+            ASN1_GENERALIZEDTIME* this_update = nullptr;
+            ASN1_GENERALIZEDTIME* next = nullptr;
+            const int status = OCSP_single_get0_status(single, &reason, &revoked_at, &this_update, &next);
+            if (status != V_OCSP_CERTSTATUS_GOOD) {
+                std::cerr << "OCSP response " << path << " reports the certificate "
+                          << OCSP_cert_status_str(status) << ", not stapling it" << std::endl;
+                return nullptr;
+            }
+
+            // Without a nextUpdate the responder promises nothing about newer information.
+            next_update = system_clock::time_point::max();
+            if (next) {
+                int days = 0;
+                int seconds = 0;
+                if (!ASN1_TIME_diff(&days, &seconds, nullptr, next) || days < 0 || seconds < 0) {
+                    std::cerr << "OCSP response " << path << " has expired" << std::endl;
+                    return nullptr;
+                }
+                next_update = system_clock::now() + std::chrono::hours(24) * days + std::chrono::seconds(seconds);
+            }
+
+            return std::make_shared<const std::string>(std::move(der));
+        }
+
+        std::cerr << "OCSP response " << path << " is not for the certificate next to it" << std::endl;
+        return nullptr;
+    }
+}
+
+OcspStapler::~OcspStapler() {
+    if (!thread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void OcspStapler::add(X509* certificate, const std::string& cert_path) {
+    std::string path = cert_path + ".ocsp";
+    std::error_code error;
+    if (!certificate || responses.contains(certificate) || !std::filesystem::exists(path, error)) {
+        return;
+    }
+
+    auto response = std::make_unique<Response>();
+    response->path = std::move(path);
+    response->certificate = certificate;
+    refresh(*response);
+    responses.emplace(certificate, std::move(response));
+}
+
+void OcspStapler::attach(SSL_CTX* ctx) {
+    if (!responses.empty()) {
+        SSL_CTX_set_tlsext_status_cb(ctx, staple);
+        SSL_CTX_set_tlsext_status_arg(ctx, this);
+    }
+}
+
+void OcspStapler::start() {
+    if (!responses.empty() && !thread.joinable()) {
+        thread = std::thread(&OcspStapler::run, this);
+    }
+}
+
+// Runs during the handshake, once the certificate is chosen, for clients that ask.
+int OcspStapler::staple(SSL* ssl, void* arg) {
+    const auto* stapler = static_cast<const OcspStapler*>(arg);
+    const auto it = stapler->responses.find(SSL_get_certificate(ssl));
+    if (it == stapler->responses.end()) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+
+    const std::shared_ptr<const std::string> der = it->second->der.load();
+    if (!der) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+
+    // The connection takes ownership of its copy.
+    auto* copy = static_cast<unsigned char*>(OPENSSL_memdup(der->data(), der->size()));
+    if (!copy) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    SSL_set_tlsext_status_ocsp_resp(ssl, copy, static_cast<long>(der->size()));
+    return SSL_TLSEXT_ERR_OK;
+}
+
+void OcspStapler::refresh(Response& response) {
+    std::error_code error;
+    const auto modified = std::filesystem::last_write_time(response.path, error);
+    if (error) {
+        if (response.der.load()) {
+            std::cerr << "OCSP response " << response.path << " is gone, no longer stapling it" << std::endl;
+            response.der.store(nullptr);
+        }
+        response.modified = {};
+        return;
+    }
+
+    // A new file replaces the response whatever it holds: a bad one is not stapled.
+    if (modified != response.modified) {
+        response.modified = modified;
+        response.expiry_warned = false;
+        response.der.store(read_response(response.path, response.certificate, response.next_update));
+    }
+
+    if (!response.der.load()) {
+        return;
+    }
+
+    const auto now = system_clock::now();
+    if (now >= response.next_update) {
+        std::cerr << "OCSP response " << response.path << " has expired, no longer stapling it" << std::endl;
+        response.der.store(nullptr);
+    } else if (!response.expiry_warned && response.next_update - now < EXPIRY_WARNING) {
+        std::cerr << "OCSP response " << response.path << " expires in "
+                  << std::chrono::duration_cast<std::chrono::minutes>(response.next_update - now).count()
+                  << " minutes; refresh it before then" << std::endl;
+        response.expiry_warned = true;
+    }
+}
+
+void OcspStapler::run() {
+    std::unique_lock lock(mutex);
+    while (!wake.wait_for(lock, REFRESH_INTERVAL, [this] { return stopping; })) {
+        lock.unlock();
+        for (const auto& [certificate, response] : responses) {
+            refresh(*response);
+        }
+        lock.lock();
+    }
+}
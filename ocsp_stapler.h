@@ -0,0 +1,61 @@
+#ifndef OCSP_STAPLER_H
+#define OCSP_STAPLER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include <openssl/ssl.h>
+
+// Staples pre-fetched OCSP responses to handshakes, so clients need no OCSP lookup of
+// their own. The response for a certificate is the DER file "<cert>.ocsp" next to it,
+// kept current by whatever fetches it (e.g. "openssl ocsp ... -respout").
+//
+// A background thread re-reads the files when they change and stops stapling a response
+// once it expires; a handshake only copies the response that is current.
+class OcspStapler {
+public:
+    OcspStapler() = default;
+    ~OcspStapler();
+
+    OcspStapler(const OcspStapler&) = delete;
+    OcspStapler& operator=(const OcspStapler&) = delete;
+
+    // Staples "<cert_path>.ocsp" to certificate, if that file exists. Call before start().
+    void add(X509* certificate, const std::string& cert_path);
+
+    // Installs the status callback on ctx and starts refreshing. Nothing happens when no
+    // certificate has a response file.
+    void attach(SSL_CTX* ctx);
+    void start();
+
+private:
+    struct Response {
+        std::string path;
+        X509* certificate = nullptr;                        // Owned by its SSL_CTX, which outlives the stapler.
+        std::filesystem::file_time_type modified{};
+        std::chrono::system_clock::time_point next_update{};
+        bool expiry_warned = false;
+        std::atomic<std::shared_ptr<const std::string>> der;   // Null while there is no valid response.
+    };
+
+    static int staple(SSL* ssl, void* arg);
+
+    static void refresh(Response& response);
+    void run();
+
+    std::unordered_map<const X509*, std::unique_ptr<Response>> responses;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread thread;
+};
+
+#endif // OCSP_STAPLER_H
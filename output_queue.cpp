@@ -0,0 +1,82 @@
+#include "output_queue.h"
+
+#include <algorithm>
+
+void OutputQueue::push(std::string data) {
+    if (data.empty()) {
+        return;
+    }
+
+    queued += data.size();
+    // Owned bytes are viewed on access, since short strings move with their segment.
+    segments.push_back({std::move(data), {}, nullptr});
+}
+
+void OutputQueue::push(const std::string_view data, std::shared_ptr<const void> storage) {
+    if (data.empty()) {
+        return;
+    }
+
+    queued += data.size();
+    segments.push_back({{}, data, std::move(storage)});
+}
+
+size_t OutputQueue::peek(std::string_view* chunks, const size_t max_chunks) const {
+    size_t count = 0;
+    size_t offset = front_offset;
+
+    for (auto it = segments.begin(); it != segments.end() && count < max_chunks; ++it) {
+        const std::string_view bytes = it->owned.empty() ? it->view : std::string_view(it->owned);
+        chunks[count++] = bytes.substr(offset);
+        offset = 0;
+    }
+
+    return count;
+}
+
+std::string_view OutputQueue::contiguous(const size_t max_bytes, std::string& scratch) const {
+    if (segments.empty()) {
+        return {};
+    }
+
+    std::string_view chunk;
+    peek(&chunk, 1);
+    if (chunk.size() >= max_bytes || segments.size() == 1) {
+        return chunk.substr(0, max_bytes);
+    }
+
+    scratch.clear();
+    size_t offset = front_offset;
+    for (auto it = segments.begin(); it != segments.end() && scratch.size() < max_bytes; ++it) {
+        const std::string_view bytes = it->owned.empty() ? it->view : std::string_view(it->owned);
+        scratch.append(bytes.substr(offset, max_bytes - scratch.size()));
+        offset = 0;
+    }
+
+    return scratch;
+}
+
+void OutputQueue::consume(size_t bytes) {
+    bytes = std::min(bytes, queued);
+    queued -= bytes;
+
+    while (bytes > 0) {
+        const Segment& front = segments.front();
+        const size_t remaining = (front.owned.empty() ? front.view.size() : front.owned.size()) - front_offset;
+
+        if (bytes < remaining) {
+            front_offset += bytes;
+            return;
+        }
+
+        bytes -= remaining;
+        front_offset = 0;
+        segments.pop_front();
+    }
+}
+
+void OutputQueue::clear() {
+    segments.clear();
+    front_offset = 0;
+    queued = 0;
+}
@@ -0,0 +1,43 @@
+#ifndef OUTPUT_QUEUE_H
+#define OUTPUT_QUEUE_H
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Per-connection queue of response bytes awaiting the socket. Segments either own
+// their bytes or view memory pinned by a storage handle (mapped archive, cached
+// file), so large bodies are queued without copying and partial writes simply
+// advance the front of the queue.
+class OutputQueue {
+public:
+    void push(std::string data);
+    void push(std::string_view data, std::shared_ptr<const void> storage);
+
+    [[nodiscard]] bool empty() const { return queued == 0; }
+    [[nodiscard]] size_t size() const { return queued; }
+
+    // Fills up to max_chunks views of the unsent bytes, in order. Returns the count.
+    size_t peek(std::string_view* chunks, size_t max_chunks) const;
+
+    // Returns up to max_bytes of unsent bytes as one contiguous view, copying
+    // small leading segments into scratch when that lets them go out together.
+    std::string_view contiguous(size_t max_bytes, std::string& scratch) const;
+
+    void consume(size_t bytes);
+    void clear();
+
+private:
+    struct Segment {
+        std::string owned;
+        std::string_view view;
+        std::shared_ptr<const void> storage;
+    };
+
+    std::deque<Segment> segments;
+    size_t front_offset = 0;
+    size_t queued = 0;
+};
+
+#endif // OUTPUT_QUEUE_H
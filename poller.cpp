@@ -0,0 +1,207 @@
+#include "poller.h"
+
+#ifdef __linux__
+
+namespace {
+    uint32_t to_epoll(const unsigned interest) {
+        uint32_t events = 0;
+        if (interest & Poller::Readable) {
+            events |= EPOLLIN | EPOLLRDHUP;
+        }
+        if (interest & Poller::Writable) {
+            events |= EPOLLOUT;
+        }
+        return events;
+    }
+}
+
+Poller::Poller() : epoll_fd(epoll_create1(EPOLL_CLOEXEC)), wake_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), buffer(256) {
+    if (epoll_fd < 0) {
+        std::cerr << "epoll_create1 failed." << std::endl;
+    }
+    if (wake_fd < 0 || !add(wake_fd, Readable)) {
+        std::cerr << "Unable to create the poller wake-up eventfd." << std::endl;
+    }
+}
+
+Poller::~Poller() {
+    if (wake_fd >= 0) {
+        close(wake_fd);
+    }
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+    }
+}
+
+void Poller::wake() {
+    const uint64_t one = 1;
+    [[maybe_unused]] const ssize_t written = write(wake_fd, &one, sizeof(one));
+}
+
+bool Poller::add(const socket_t socket, const unsigned interest) {
+    epoll_event event{};
+    event.events = to_epoll(interest);
+    event.data.fd = socket;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, socket, &event) == 0;
+}
+
+void Poller::modify(const socket_t socket, const unsigned interest) {
+    epoll_event event{};
+    event.events = to_epoll(interest);
+    event.data.fd = socket;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, socket, &event);
+}
+
+void Poller::remove(const socket_t socket) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, socket, nullptr);
+}
+
+int Poller::wait(std::vector<Event>& events, const int timeout_ms) {
+    events.clear();
+
+    const int count = epoll_wait(epoll_fd, buffer.data(), static_cast<int>(buffer.size()), timeout_ms);
+    for (int i = 0; i < count; ++i) {
+        if (buffer[i].data.fd == wake_fd) {
+            uint64_t wakes = 0;
+            [[maybe_unused]] const ssize_t received = read(wake_fd, &wakes, sizeof(wakes));
+            continue;
+        }
+
+        const uint32_t ready = buffer[i].events;
+        unsigned mapped = 0;
+        if (ready & (EPOLLIN | EPOLLRDHUP)) {
+            mapped |= Readable;
+        }
+        if (ready & EPOLLOUT) {
+            mapped |= Writable;
+        }
+        if (ready & (EPOLLERR | EPOLLHUP)) {
+            mapped |= Readable | Writable;
+        }
+        events.push_back({buffer[i].data.fd, mapped});
+    }
+
+    if (count == static_cast<int>(buffer.size())) {
+        buffer.resize(buffer.size() * 2);
+    }
+
+    return count;
+}
+
+#else
+
+namespace {
+    short to_poll(const unsigned interest) {
+        short events = 0;
+        if (interest & Poller::Readable) {
+            events |= POLLIN;
+        }
+        if (interest & Poller::Writable) {
+            events |= POLLOUT;
+        }
+        return events;
+    }
+}
+
+Poller::Poller() : wake_socket(socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+
+    // Bound to an ephemeral loopback port and connected to itself, it reads back what it sends.
+    if (wake_socket == INVALID_SOCKET ||
+        bind(wake_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR ||
+        getsockname(wake_socket, reinterpret_cast<sockaddr*>(&address), &length) == SOCKET_ERROR ||
+        connect(wake_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR ||
+        !set_nonblocking(wake_socket) || !add(wake_socket, Readable)) {
+        std::cerr << "Unable to create the poller wake-up socket." << std::endl;
+    }
+}
+
+Poller::~Poller() {
+    if (wake_socket != INVALID_SOCKET) {
+        CLOSESOCKET(wake_socket);
+    }
+}
+
+void Poller::wake() {
+    const char byte = 0;
+    send(wake_socket, &byte, 1, 0);
+}
+
+bool Poller::add(const socket_t socket, const unsigned interest) {
+    if (index.contains(socket)) {
+        return false;
+    }
+
+    index[socket] = descriptors.size();
+    descriptors.push_back({socket, to_poll(interest), 0});
+    return true;
+}
+
+void Poller::modify(const socket_t socket, const unsigned interest) {
+    if (const auto it = index.find(socket); it != index.end()) {
+        descriptors[it->second].events = to_poll(interest);
+    }
+}
+
+void Poller::remove(const socket_t socket) {
+    const auto it = index.find(socket);
+    if (it == index.end()) {
+        return;
+    }
+
+    const size_t position = it->second;
+    index.erase(it);
+
+    if (position != descriptors.size() - 1) {
+        descriptors[position] = descriptors.back();
+        index[descriptors[position].fd] = position;
+    }
+    descriptors.pop_back();
+}
+
+int Poller::wait(std::vector<Event>& events, const int timeout_ms) {
+    events.clear();
+
+#ifdef _WIN32
+    // WSAPoll rejects an empty set.
+    if (descriptors.empty()) {
+        Sleep(timeout_ms < 0 ? INFINITE : static_cast<DWORD>(timeout_ms));
+        return 0;
+    }
+    const int count = WSAPoll(descriptors.data(), static_cast<ULONG>(descriptors.size()), timeout_ms);
+#else
+    const int count = poll(descriptors.data(), descriptors.size(), timeout_ms);
+#endif
+
+    for (const auto& descriptor : descriptors) {
+        if (descriptor.revents == 0) {
+            continue;
+        }
+
+        if (descriptor.fd == wake_socket) {
+            char drain[64];
+            while (recv(wake_socket, drain, sizeof(drain), 0) > 0) {
+            }
+            continue;
+        }
+
+        unsigned mapped = 0;
+        if (descriptor.revents & POLLIN) {
+            mapped |= Readable;
+        }
+        if (descriptor.revents & POLLOUT) {
+            mapped |= Writable;
+        }
+        if (descriptor.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            mapped |= Readable | Writable;
+        }
+        events.push_back({descriptor.fd, mapped});
+    }
+
+    return count;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef POLLER_H
+#define POLLER_H
+
+#include "socket_compat.h"
+
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#elif !defined(_WIN32)
+#include <poll.h>
+#endif
+
+// Level-triggered readiness notification: epoll on Linux, poll()/WSAPoll() elsewhere.
+class Poller {
+public:
+    enum Interest : unsigned {
+        Readable = 1u << 0,
+        Writable = 1u << 1,
+    };
+
+    struct Event {
+        socket_t socket;
+        unsigned ready;     // Errors and hang-ups are reported as Readable | Writable.
+    };
+
+    Poller();
+    ~Poller();
+
+    Poller(const Poller&) = delete;
+    Poller& operator=(const Poller&) = delete;
+
+    bool add(socket_t socket, unsigned interest);
+    void modify(socket_t socket, unsigned interest);
+    void remove(socket_t socket);
+
+    // Waits up to timeout_ms (-1 blocks) and replaces the contents of events.
+    int wait(std::vector<Event>& events, int timeout_ms);
+
+    // Makes the current or next wait() return. Safe to call from any thread.
+    void wake();
+
+private:
+#ifdef __linux__
+    int epoll_fd = -1;
+    int wake_fd = -1;   // eventfd
+    std::vector<epoll_event> buffer;
+#else
+    socket_t wake_socket = INVALID_SOCKET;  // Loopback UDP socket connected to itself.
+#ifdef _WIN32
+    std::vector<WSAPOLLFD> descriptors;
+#else
+    std::vector<pollfd> descriptors;
+#endif
+    std::unordered_map<socket_t, size_t> index;
+#endif
+};
+
+#endif // POLLER_H
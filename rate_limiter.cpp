@@ -0,0 +1,156 @@
+#include "rate_limiter.h"
+
+#include <algorithm>
+
+namespace {
+    constexpr uint32_t AGE_INTERVAL_MS = 1000;
+
+    uint64_t hash_address(const uint32_t address) {
+        return address * 0x9E3779B97F4A7C15ull;
+    }
+
+    RateLimiter::Limit normalized(RateLimiter::Limit limit) {
+        if (limit.enabled()) {
+            if (limit.burst <= 0) {
+                limit.burst = limit.rate;
+            }
+            limit.burst = std::max(limit.burst, 1.0);
+        }
+        return limit;
+    }
+}
+
+RateLimiter::RateLimiter(const Limit connections, const Limit requests, const clock::time_point now) :
+    connections(normalized(connections)),
+    requests(normalized(requests)),
+    start(now) {
+    if (enabled()) {
+        for (Shard& shard : shards) {
+            shard.entries.resize(SHARD_CAPACITY);
+        }
+    }
+}
+
+bool RateLimiter::allow_connection(const uint32_t address, const clock::time_point now) {
+    if (!enabled()) {
+        return true;
+    }
+
+    Entry* entry = find_or_insert(address, elapsed_ms(now));
+    if (!entry) {
+        return true;    // Shard full: fail open rather than refuse strangers.
+    }
+
+    if (requests.enabled() && entry->request_tokens < 1) {
+        return false;
+    }
+    if (connections.enabled()) {
+        if (entry->connection_tokens < 1) {
+            return false;
+        }
+        entry->connection_tokens -= 1;
+    }
+    return true;
+}
+
+bool RateLimiter::allow_request(const uint32_t address, const clock::time_point now) {
+    if (!requests.enabled()) {
+        return true;
+    }
+
+    Entry* entry = find_or_insert(address, elapsed_ms(now));
+    if (!entry) {
+        return true;
+    }
+
+    if (entry->request_tokens < 1) {
+        return false;
+    }
+    entry->request_tokens -= 1;
+    return true;
+}
+
+void RateLimiter::age(const clock::time_point now) {
+    const uint32_t now_ms = elapsed_ms(now);
+    if (!enabled() || now_ms - last_aged_ms < AGE_INTERVAL_MS) {
+        return;
+    }
+    last_aged_ms = now_ms;
+
+    Shard& shard = shards[next_shard];
+    next_shard = (next_shard + 1) % SHARDS;
+
+    size_t index = 0;
+    while (index < SHARD_CAPACITY && shard.count > 0) {
+        Entry& entry = shard.entries[index];
+        if (entry.used) {
+            refill(entry, now_ms);
+            const bool connections_full = !connections.enabled() || entry.connection_tokens >= static_cast<float>(connections.burst);
+            const bool requests_full = !requests.enabled() || entry.request_tokens >= static_cast<float>(requests.burst);
+            if (connections_full && requests_full) {
+                // Erasing shifts a later entry into this slot, so look at it again.
+                erase(shard, index);
+                continue;
+            }
+        }
+        ++index;
+    }
+}
+
+RateLimiter::Entry* RateLimiter::find_or_insert(const uint32_t address, const uint32_t now_ms) {
+    const uint64_t hash = hash_address(address);
+    Shard& shard = shards[hash >> (64 - SHARD_BITS)];
+    const size_t mask = SHARD_CAPACITY - 1;
+
+    size_t index = (hash >> 20) & mask;
+    for (size_t probe = 0; probe < MAX_PROBE; ++probe, index = (index + 1) & mask) {
+        Entry& entry = shard.entries[index];
+        if (entry.used && entry.address == address) {
+            refill(entry, now_ms);
+            return &entry;
+        }
+        if (!entry.used) {
+            entry.used = true;
+            entry.address = address;
+            entry.connection_tokens = static_cast<float>(connections.burst);
+            entry.request_tokens = static_cast<float>(requests.burst);
+            entry.updated_ms = now_ms;
+            ++shard.count;
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void RateLimiter::refill(Entry& entry, const uint32_t now_ms) const {
+    const double elapsed = (now_ms - entry.updated_ms) / 1000.0;
+    entry.updated_ms = now_ms;
+
+    entry.connection_tokens = static_cast<float>(
+        std::min(connections.burst, entry.connection_tokens + elapsed * connections.rate));
+    entry.request_tokens = static_cast<float>(
+        std::min(requests.burst, entry.request_tokens + elapsed * requests.rate));
+}
+
+// Backward-shift deletion: pull following entries of the probe run into the hole,
+// as long as that does not move them in front of their home slot.
+void RateLimiter::erase(Shard& shard, size_t index) {
+    const size_t mask = SHARD_CAPACITY - 1;
+
+    size_t hole = index;
+    size_t next = (hole + 1) & mask;
+    for (size_t step = 1; step < SHARD_CAPACITY && shard.entries[next].used; ++step, next = (next + 1) & mask) {
+        const size_t home = (hash_address(shard.entries[next].address) >> 20) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            shard.entries[hole] = shard.entries[next];
+            hole = next;
+        }
+    }
+
+    shard.entries[hole] = Entry{};
+    --shard.count;
+}
+
+uint32_t RateLimiter::elapsed_ms(const clock::time_point now) const {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count());
+}
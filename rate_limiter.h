@@ -0,0 +1,67 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Per-client token buckets for new connections and requests, keyed by IPv4 address.
+// Entries live in fixed-size open-addressing shards with linear probing, so a lookup
+// is a hash and a short probe with no allocation. Buckets refill lazily when touched;
+// age() periodically sweeps one shard and drops clients whose buckets are full again,
+// since those are indistinguishable from clients never seen.
+class RateLimiter {
+public:
+    using clock = std::chrono::steady_clock;
+
+    struct Limit {
+        double rate = 0;    // Tokens per second; zero disables the limit.
+        double burst = 0;   // Bucket size; zero means rate, and at least one token.
+
+        [[nodiscard]] bool enabled() const { return rate > 0; }
+    };
+
+    RateLimiter(Limit connections, Limit requests, clock::time_point now = clock::now());
+
+    [[nodiscard]] bool enabled() const { return connections.enabled() || requests.enabled(); }
+
+    // Takes a connection token. Also refuses clients whose request bucket is empty,
+    // so they cannot cost a handshake only to be refused their first request.
+    bool allow_connection(uint32_t address, clock::time_point now);
+    bool allow_request(uint32_t address, clock::time_point now);
+
+    void age(clock::time_point now);
+
+private:
+    static constexpr unsigned SHARD_BITS = 4;
+    static constexpr unsigned SHARDS = 1u << SHARD_BITS;
+    static constexpr size_t SHARD_CAPACITY = 1024;  // Power of two.
+    static constexpr size_t MAX_PROBE = 32;
+
+    struct Entry {
+        uint32_t address = 0;
+        bool used = false;
+        float connection_tokens = 0;
+        float request_tokens = 0;
+        uint32_t updated_ms = 0;    // Since start; wraps after 49 days, which only over-refills.
+    };
+
+    struct Shard {
+        std::vector<Entry> entries;
+        size_t count = 0;
+    };
+
+    Entry* find_or_insert(uint32_t address, uint32_t now_ms);
+    void refill(Entry& entry, uint32_t now_ms) const;
+    void erase(Shard& shard, size_t index);
+    uint32_t elapsed_ms(clock::time_point now) const;
+
+    Limit connections;
+    Limit requests;
+    clock::time_point start;
+    Shard shards[SHARDS];
+    unsigned next_shard = 0;
+    uint32_t last_aged_ms = 0;
+};
+
+#endif // RATE_LIMITER_H
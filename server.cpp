@@ -1,88 +1,999 @@
 #include "server.h"
 #include <iostream>
 #include <string>
+#include <atomic>
+#include <csignal>
+#include <cctype>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 #include "webpage_handler.h"
+#include "archive.h"
+#include "config_reloader.h"
+#include "handshake_pool.h"
+#include "http2.h"
+#include "http_request.h"
+#include "output_queue.h"
+#include "poller.h"
+#include "rate_limiter.h"
+#include "socket_compat.h"
+#include "timer_wheel.h"
+#include "tls_context.h"
 
-#ifdef _WIN32
-    #include <winsock2.h>
-    #include <ws2tcpip.h>
-    using socket_t = SOCKET;
-    #define CLOSESOCKET closesocket
-    #define INIT_SOCKET() \
-        WSADATA wsaData; \
-        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) { \
-            std::cerr << "WSAStartup failed." << std::endl; \
-            return -1; \
-        }
-    #define CLEANUP_SOCKET() WSACleanup()
-#else
-#include <unistd.h>
-#include <cstring>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-using socket_t = int;
-#define INVALID_SOCKET (-1)
-#define SOCKET_ERROR (-1)
-#define CLOSESOCKET close
-#define INIT_SOCKET()
-#define CLEANUP_SOCKET()
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
 #endif
 
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 
-void init_openssl() {
-    SSL_load_error_strings();
-    OpenSSL_add_ssl_algorithms();
+namespace {
+    constexpr size_t MAX_REQUEST_HEADER_SIZE = 16 * 1024;
+    constexpr size_t READ_BUFFER_SIZE = 16 * 1024;
+
+    // Reading from a connection pauses once this much output is queued and resumes
+    // when the client has drained it below the low watermark.
+    constexpr size_t OUTPUT_HIGH_WATERMARK = 256 * 1024;
+    constexpr size_t OUTPUT_LOW_WATERMARK = 64 * 1024;
+
+    constexpr size_t MAX_WRITE_CHUNKS = 16;
+
+    // HTTP/2 responses are cut into frames as the socket takes them, with no more than this
+    // queued ahead, so a more urgent stream that arrives meanwhile does not wait behind it.
+    constexpr size_t HTTP2_OUTPUT_LIMIT = 64 * 1024;
+
+    // Dynamic TLS record sizing. A response, or output resuming after an idle second, starts
+    // with records that fit one TCP segment, so the browser can decrypt and parse the first
+    // bytes as they arrive. About an initial congestion window later it moves on to full
+    // 16 KB records, which cost the least per byte.
+    constexpr size_t TLS_SMALL_RECORD_SIZE = 1400;
+    constexpr size_t TLS_SMALL_RECORD_BYTES = 16 * 1024;
+    constexpr size_t TLS_WRITE_SIZE = 16 * 1024;
+    constexpr std::chrono::seconds TLS_RECORD_IDLE_RESET{1};
+
+    constexpr std::chrono::seconds HANDSHAKE_REPORT_INTERVAL{10};
+    constexpr int MAX_WAIT_MS = 1000;
+
+    // The deadline a connection is currently held to. Only one is pending at a time.
+    enum class Deadline {
+        None,
+        Header,     // Handshake or request headers not yet complete.
+        Write,      // Response bytes queued.
+        Idle,       // Kept alive, waiting for the next request.
+    };
+
+    // Everything a reload replaces, published as one immutable snapshot. The reload thread
+    // stores a new one; the event loop picks it up between iterations, and the previous
+    // one lives on for as long as connections still refer to it.
+    struct Settings {
+        std::shared_ptr<const Config> config;
+        std::shared_ptr<const TlsContexts> tls;   // Null without HTTPS.
+        std::shared_ptr<const Archive> archive;   // Null when serving the www directory.
+    };
+
+    struct Connection {
+        socket_t socket = INVALID_SOCKET;
+        sockaddr_in address{};
+        SSL* ssl = nullptr;
+
+        bool handshake_complete = false;
+        bool handshake_wants_write = false;
+        bool handshake_waiting = false;     // The last handshake step stopped for socket I/O.
+        bool handshake_failed = false;
+        bool handshake_busy = false;        // A handshake thread holds the connection.
+        bool timed_out = false;             // The deadline passed while a handshake thread held it.
+        bool reading_early_data = false;    // TLS 1.3 0-RTT: taking requests before the handshake completes.
+        bool write_wants_read = false;
+        std::unique_ptr<Http2Session> http2;    // Set once the connection turns out to speak HTTP/2.
+        bool reading_paused = false;
+        bool close_when_flushed = false;
+        bool output_progressed = false;
+        unsigned interest = 0;
+        size_t requests_served = 0;
+
+        // Snapshot the connection was accepted under; deadlines and the handshake's
+        // certificate selection keep using it after a reload.
+        std::shared_ptr<const Settings> settings;
+
+        Deadline deadline = Deadline::None;
+        TimerWheel::Timer timer;
+
+        std::string input;
+        OutputQueue output;
+        std::string tls_scratch;
+        size_t tls_ramp_bytes = 0;                          // Written since records were last made small.
+        size_t tls_pending_write = 0;                       // Length of a TLS write to retry as is, or zero.
+        TimerWheel::clock::time_point last_tls_write{};
+
+        Connection() = default;
+        Connection(const Connection&) = delete;
+        Connection& operator=(const Connection&) = delete;
+
+        ~Connection() {
+            if (ssl) {
+                SSL_free(ssl);
+            }
+            if (socket != INVALID_SOCKET) {
+                CLOSESOCKET(socket);
+            }
+        }
+    };
+
+    using ConnectionMap = std::unordered_map<socket_t, std::unique_ptr<Connection>>;
+
+    std::atomic<std::shared_ptr<const Settings>> published_settings;
+
+    // Admission state of the event loop. loop_lag is a moving average of how long one
+    // iteration takes, i.e. how long a newly ready socket waits before it is served.
+    struct LoadState {
+        double loop_lag_ms = 0;
+        bool shedding = false;
+        bool accept_paused = false;
+        std::string shed_headers;
+        std::string shed_response;
+
+        std::unique_ptr<RateLimiter> rate_limiter;
+        std::string rate_limited_response;
+    };
+
+    LoadState load;
+
+    constexpr std::string_view RATE_LIMITED_HEADERS = "Retry-After: 1\r\nContent-Length: 0\r\n";
+
+    constexpr double LOOP_LAG_SMOOTHING = 0.25;
+
+    std::string client_name(const sockaddr_in& address) {
+        return std::string(inet_ntoa(address.sin_addr)) + ":" + std::to_string(ntohs(address.sin_port));
+    }
+}
+
+#ifdef SIGHUP
+volatile std::sig_atomic_t reload_requested = 0;
+
+void handle_sighup(int) {
+    reload_requested = 1;
+}
+
+void install_reload_handler() {
+    struct sigaction action{};
+    action.sa_handler = handle_sighup;
+    sigemptyset(&action.sa_mask);
+    // No SA_RESTART: a blocking wait returns EINTR so the reload runs immediately.
+    action.sa_flags = 0;
+    sigaction(SIGHUP, &action, nullptr);
+}
+#endif
+
+void update_interest(Poller& poller, Connection& connection) {
+    unsigned interest = 0;
+
+    if (!connection.handshake_complete) {
+        interest = connection.handshake_wants_write ? Poller::Writable : Poller::Readable;
+    } else {
+        if ((!connection.reading_paused && !connection.close_when_flushed) || connection.write_wants_read) {
+            interest |= Poller::Readable;
+        }
+        if (!connection.output.empty() && !connection.write_wants_read) {
+            interest |= Poller::Writable;
+        }
+    }
+
+    if (interest != connection.interest) {
+        poller.modify(connection.socket, interest);
+        connection.interest = interest;
+    }
+}
+
+// Size of the next TLS write for the connection; see TLS_SMALL_RECORD_SIZE. A write that
+// stopped for the socket holds its record inside OpenSSL and must be retried with the
+// same length, whatever the ramp says meanwhile.
+size_t tls_record_size(const Connection& connection) {
+    if (connection.tls_pending_write > 0) {
+        return connection.tls_pending_write;
+    }
+    return connection.tls_ramp_bytes < TLS_SMALL_RECORD_BYTES ? TLS_SMALL_RECORD_SIZE : TLS_WRITE_SIZE;
+}
+
+// Writes as much queued output as the socket takes. Returns false on a fatal error.
+bool flush_output(Connection& connection) {
+    OutputQueue& output = connection.output;
+
+    if (connection.ssl && !output.empty()) {
+        // After an idle spell the congestion window may have shrunk again.
+        const auto now = TimerWheel::clock::now();
+        if (connection.tls_pending_write == 0 && now - connection.last_tls_write >= TLS_RECORD_IDLE_RESET) {
+            connection.tls_ramp_bytes = 0;
+        }
+        connection.last_tls_write = now;
+    }
+
+    while (!output.empty()) {
+        if (connection.ssl && !connection.handshake_complete) {
+            // Responses to early data go out right behind the server's handshake flight. Once
+            // the client has ended its early data, the rest waits for the handshake.
+            if (!connection.reading_early_data) {
+                return true;
+            }
+
+            const std::string_view chunk = output.contiguous(tls_record_size(connection), connection.tls_scratch);
+            size_t written = 0;
+            ERR_clear_error();
+            if (SSL_write_early_data(connection.ssl, chunk.data(), chunk.size(), &written) != 1) {
+                const int error = SSL_get_error(connection.ssl, 0);
+                connection.tls_pending_write = chunk.size();
+                return error == SSL_ERROR_WANT_WRITE || error == SSL_ERROR_WANT_READ;
+            }
+            connection.tls_pending_write = 0;
+            output.consume(written);
+            connection.tls_ramp_bytes += written;
+            connection.output_progressed = true;
+            continue;
+        }
+
+        if (connection.ssl) {
+            const std::string_view chunk = output.contiguous(tls_record_size(connection), connection.tls_scratch);
+
+            ERR_clear_error();
+            const int written = SSL_write(connection.ssl, chunk.data(), static_cast<int>(chunk.size()));
+            if (written > 0) {
+                connection.tls_pending_write = 0;
+                output.consume(static_cast<size_t>(written));
+                connection.tls_ramp_bytes += static_cast<size_t>(written);
+                connection.output_progressed = true;
+                continue;
+            }
+
+            switch (SSL_get_error(connection.ssl, written)) {
+                case SSL_ERROR_WANT_WRITE:
+                    connection.tls_pending_write = chunk.size();
+                    return true;
+                case SSL_ERROR_WANT_READ:
+                    connection.tls_pending_write = chunk.size();
+                    connection.write_wants_read = true;
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        std::string_view chunks[MAX_WRITE_CHUNKS];
+        const size_t count = output.peek(chunks, MAX_WRITE_CHUNKS);
+
+#ifdef _WIN32
+        WSABUF buffers[MAX_WRITE_CHUNKS];
+        for (size_t i = 0; i < count; ++i) {
+            buffers[i].buf = const_cast<char*>(chunks[i].data());
+            buffers[i].len = static_cast<ULONG>(chunks[i].size());
+        }
+
+        DWORD sent_bytes = 0;
+        const long long sent = WSASend(connection.socket, buffers, static_cast<DWORD>(count), &sent_bytes, 0,
+                                       nullptr, nullptr) == 0 ? sent_bytes : -1;
+#else
+        iovec vectors[MAX_WRITE_CHUNKS];
+        for (size_t i = 0; i < count; ++i) {
+            vectors[i].iov_base = const_cast<char*>(chunks[i].data());
+            vectors[i].iov_len = chunks[i].size();
+        }
+
+        msghdr message{};
+        message.msg_iov = vectors;
+        message.msg_iovlen = count;
+        const long long sent = sendmsg(connection.socket, &message, MSG_NOSIGNAL);
+#endif
+
+        if (sent < 0) {
+            if (SOCKET_WOULD_BLOCK()) {
+                return true;
+            }
+            if (SOCKET_INTERRUPTED()) {
+                continue;
+            }
+            return false;
+        }
+
+        output.consume(static_cast<size_t>(sent));
+        connection.output_progressed = true;
+    }
+
+    return true;
+}
+
+// Writes queued output like flush_output(). On HTTP/2 connections the session queues
+// frames whenever the queue has drained, until the socket is full or nothing may be sent.
+bool write_output(Connection& connection) {
+    if (!connection.http2) {
+        return flush_output(connection);
+    }
+
+    while (true) {
+        connection.http2->write(connection.output, HTTP2_OUTPUT_LIMIT);
+        const size_t queued = connection.output.size();
+        if (!flush_output(connection)) {
+            return false;
+        }
+        if (queued == 0 || !connection.output.empty()) {
+            return true;
+        }
+    }
+}
+
+void handle_request(Connection& connection, const std::string& head) {
+    HttpRequest request;
+    if (!parse_http_request(head, request)) {
+        connection.output.push(std::string(status_line(400)) +
+                               "Content-Length: 0\r\nConnection: close\r\n\r\n");
+        connection.close_when_flushed = true;
+        return;
+    }
+
+    std::cout << "Extracted URL: " << request.target << std::endl;
+    ++connection.requests_served;
+
+    if (!load.rate_limiter->allow_request(connection.address.sin_addr.s_addr, TimerWheel::clock::now())) {
+        std::cout << "Client " << client_name(connection.address) << " rate limited." << std::endl;
+        connection.output.push(load.rate_limited_response);
+        connection.close_when_flushed = true;
+        return;
+    }
+
+    // Shed before doing any work for the request: answer fast and let the client retry.
+    if (load.shedding) {
+        connection.output.push(load.shed_response);
+        connection.close_when_flushed = true;
+        return;
+    }
+
+    const WebResponse page = webpage_handler(request.target, request.header_accepts("Accept-Encoding", "gzip"));
+
+    // Request bodies are not read, so a request carrying one ends the connection
+    // rather than having its body parsed as the next request.
+    const bool http10 = request.version == "HTTP/1.0";
+    const bool has_body = !request.header("Content-Length").empty() &&
+                          request.header("Content-Length") != "0";
+    const bool keep_alive = !has_body && request.header("Transfer-Encoding").empty() &&
+                            (http10 ? request.header_has_token("Connection", "keep-alive")
+                                    : !request.header_has_token("Connection", "close"));
+
+    // A response the client is waiting on starts with small records again.
+    if (connection.output.empty()) {
+        connection.tls_ramp_bytes = 0;
+    }
+
+    // The browser can fetch what the page needs while the page itself is still on its way.
+    // HTTP/1.0 clients do not expect interim responses, and a HEAD gets no page to render.
+    const bool early_hints = connection.settings->config->early_hints && page.status == 200 && !page.links.empty();
+    if (early_hints && !http10 && request.method != "HEAD") {
+        connection.output.push(std::string(status_line(103)) + std::string(page.links) + "\r\n");
+    }
+
+    std::string response_head(status_line(page.status));
+    response_head.append(page.headers);
+    if (early_hints) {
+        response_head.append(page.links);
+    }
+    if (!keep_alive) {
+        response_head.append("Connection: close\r\n");
+    } else if (http10) {
+        response_head.append("Connection: keep-alive\r\n");
+    }
+    response_head.append("\r\n");
+
+    connection.output.push(std::move(response_head));
+    if (request.method != "HEAD") {
+        connection.output.push(page.body, page.storage);
+    }
+
+    connection.close_when_flushed = !keep_alive;
+
+    if (connection.output.size() >= OUTPUT_HIGH_WATERMARK) {
+        connection.reading_paused = true;
+    }
+}
+
+// Answers a request that came in on an HTTP/2 stream. Refusals end only that stream.
+void handle_http2_request(Connection& connection, const Http2Session::Request& stream) {
+    const HttpRequest& request = stream.request;
+    Http2Session& session = *connection.http2;
+
+    std::cout << "Extracted URL: " << request.target << std::endl;
+    ++connection.requests_served;
+
+    if (!load.rate_limiter->allow_request(connection.address.sin_addr.s_addr, TimerWheel::clock::now())) {
+        std::cout << "Client " << client_name(connection.address) << " rate limited." << std::endl;
+        session.respond(stream.stream_id, 429, RATE_LIMITED_HEADERS, {}, nullptr);
+        return;
+    }
+
+    if (load.shedding) {
+        session.respond(stream.stream_id, 503, load.shed_headers, {}, nullptr);
+        return;
+    }
+
+    const WebResponse page = webpage_handler(request.target, request.header_accepts("Accept-Encoding", "gzip"));
+
+    if (connection.output.empty()) {
+        connection.tls_ramp_bytes = 0;
+    }
+
+    std::string_view headers = page.headers;
+    std::string headers_with_links;
+    if (connection.settings->config->early_hints && page.status == 200 && !page.links.empty()) {
+        if (request.method != "HEAD") {
+            session.inform(stream.stream_id, 103, page.links);
+        }
+        headers_with_links = std::string(page.headers) + std::string(page.links);
+        headers = headers_with_links;
+    }
+
+    session.respond(stream.stream_id, page.status, headers,
+                    request.method == "HEAD" ? std::string_view() : page.body, page.storage);
+}
+
+// Feeds input to the HTTP/2 session and answers the requests it completes.
+void process_http2_input(Connection& connection) {
+    Http2Session& session = *connection.http2;
+
+    std::vector<Http2Session::Request> requests;
+    const bool valid = session.receive(connection.input, requests);
+
+    for (const Http2Session::Request& request : requests) {
+        handle_http2_request(connection, request);
+    }
+
+    if (!valid) {
+        std::cerr << "Client " << client_name(connection.address) << " broke the HTTP/2 protocol." << std::endl;
+    }
+    if (!valid || session.finished()) {
+        connection.close_when_flushed = true;
+    }
+
+    // Control frames answer the client's own; stop reading while it does not take them.
+    session.write(connection.output, HTTP2_OUTPUT_LIMIT);
+    if (connection.output.size() >= OUTPUT_HIGH_WATERMARK) {
+        connection.reading_paused = true;
+    }
+}
+
+// Decides, before the first request is parsed, whether the connection speaks HTTP/2:
+// on HTTPS when ALPN chose it, on plain HTTP when the client starts with the HTTP/2
+// preface (prior knowledge). Returns false while that cannot be told yet.
+bool detect_http2(Connection& connection) {
+    if (connection.http2 || connection.requests_served > 0 || !connection.settings->config->http2) {
+        return true;
+    }
+
+    if (connection.ssl) {
+        const unsigned char* protocol = nullptr;
+        unsigned int length = 0;
+        SSL_get0_alpn_selected(connection.ssl, &protocol, &length);
+        if (std::string_view(reinterpret_cast<const char*>(protocol), length) != "h2") {
+            return true;
+        }
+        // Early data is answered over HTTP/1.1 only; HTTP/2 requests wait for the handshake.
+        if (!connection.handshake_complete) {
+            return false;
+        }
+    } else {
+        const std::string_view start = std::string_view(connection.input).substr(0, HTTP2_PREFACE.size());
+        if (!HTTP2_PREFACE.starts_with(start)) {
+            return true;
+        }
+        if (start.size() < HTTP2_PREFACE.size()) {
+            return false;
+        }
+    }
+
+    connection.http2 = std::make_unique<Http2Session>();
+    return true;
+}
+
+// Splits complete requests off the input buffer. Returns false if the connection must close.
+bool process_input(Connection& connection) {
+    if (!detect_http2(connection)) {
+        return true;
+    }
+
+    if (connection.http2) {
+        if (!connection.reading_paused && !connection.close_when_flushed) {
+            process_http2_input(connection);
+        }
+        return true;
+    }
+
+    while (!connection.reading_paused && !connection.close_when_flushed) {
+        const size_t header_end = connection.input.find("\r\n\r\n");
+        if (header_end == std::string::npos) {
+            if (connection.input.size() > MAX_REQUEST_HEADER_SIZE) {
+                std::cerr << "Client " << client_name(connection.address) << " sent oversized request headers."
+                          << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        // Early data can be replayed by an attacker, so before the handshake completes only
+        // GET and HEAD are served; anything else, and what follows it, waits (RFC 8470).
+        if (!connection.handshake_complete &&
+            !connection.input.starts_with("GET ") && !connection.input.starts_with("HEAD ")) {
+            return true;
+        }
+
+        const std::string request = connection.input.substr(0, header_end + 4);
+        connection.input.erase(0, header_end + 4);
+        handle_request(connection, request);
+    }
+
+    return true;
+}
+
+// Reads until the socket would block or reading pauses. Returns false if the connection must close.
+bool read_input(Connection& connection) {
+    char buffer[READ_BUFFER_SIZE];
+
+    while (!connection.reading_paused && !connection.close_when_flushed) {
+        int received;
+
+        if (connection.ssl) {
+            ERR_clear_error();
+            received = SSL_read(connection.ssl, buffer, sizeof(buffer));
+            if (received <= 0) {
+                const int error = SSL_get_error(connection.ssl, received);
+                if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) {
+                    return true;
+                }
+                received = 0;
+            }
+        } else {
+            received = static_cast<int>(recv(connection.socket, buffer, sizeof(buffer), 0));
+            if (received < 0) {
+                if (SOCKET_WOULD_BLOCK()) {
+                    return true;
+                }
+                if (SOCKET_INTERRUPTED()) {
+                    continue;
+                }
+                received = 0;
+            }
+        }
+
+        if (received == 0) {
+            // A client may half-close right after its last request; finish writing the responses.
+            if (!connection.output.empty()) {
+                connection.close_when_flushed = true;
+                return true;
+            }
+            if (connection.requests_served == 0 || !connection.input.empty()) {
+                std::cerr << "Failed to receive data from client." << std::endl;
+            }
+            return false;
+        }
+
+        connection.input.append(buffer, static_cast<size_t>(received));
+
+        if (!process_input(connection)) {
+            return false;
+        }
+    }
+
+    return true;
 }
 
-void cleanup_openssl() {
-    ERR_free_strings();
-    EVP_cleanup();
+std::chrono::milliseconds deadline_timeout(const Deadline deadline, const Config& config) {
+    switch (deadline) {
+        case Deadline::Header:
+            return config.header_timeout;
+        case Deadline::Write:
+            return config.write_timeout;
+        case Deadline::Idle:
+            return config.keepalive_timeout;
+        default:
+            return std::chrono::milliseconds::zero();
+    }
 }
 
-SSL_CTX* create_ssl_context() {
-    const SSL_METHOD* method = TLS_server_method();
-    SSL_CTX* ctx = SSL_CTX_new(method);
+// Arms the timer for the connection's current state. Header and idle deadlines run
+// from when the state was entered, so trickling bytes does not extend them; the
+// write deadline restarts whenever the client accepts more output.
+void refresh_deadline(TimerWheel& timers, Connection& connection) {
+    Deadline wanted = Deadline::Idle;
+    if (!connection.output.empty() || (connection.http2 && connection.http2->has_pending())) {
+        wanted = Deadline::Write;
+    } else if (!connection.handshake_complete || !connection.input.empty()) {
+        wanted = Deadline::Header;
+    }
+
+    const bool restart = wanted == Deadline::Write && connection.output_progressed;
+    connection.output_progressed = false;
+
+    if (wanted == connection.deadline && !restart) {
+        return;
+    }
+
+    connection.deadline = wanted;
 
-    if (!ctx) {
-        std::cerr << "Unable to create SSL context." << std::endl;
-        ERR_print_errors_fp(stderr);
-        return nullptr;
+    if (const auto timeout = deadline_timeout(wanted, *connection.settings->config); timeout > std::chrono::milliseconds::zero()) {
+        timers.schedule(connection.timer, timeout);
+    } else {
+        timers.cancel(connection.timer);
     }
+}
 
-    return ctx;
+const char* deadline_name(const Deadline deadline) {
+    switch (deadline) {
+        case Deadline::Header:
+            return "request header";
+        case Deadline::Write:
+            return "write";
+        case Deadline::Idle:
+            return "keep-alive";
+        default:
+            return "unknown";
+    }
 }
 
-bool configure_ssl_context(SSL_CTX* ctx, const char* cert_path, const char* key_path) {
-    if (SSL_CTX_use_certificate_file(ctx, cert_path, SSL_FILETYPE_PEM) <= 0) {
-        std::cerr << "Error loading certificate" << std::endl;
-        ERR_print_errors_fp(stderr);
+// Advances an established connection after a readiness event. Returns false once it
+// should be closed.
+bool serve_connection(Poller& poller, Connection& connection, unsigned ready) {
+    if ((ready & Poller::Writable) || (connection.write_wants_read && (ready & Poller::Readable))) {
+        connection.write_wants_read = false;
+        if (!write_output(connection)) {
+            return false;
+        }
+    }
+
+    if (connection.reading_paused && connection.output.size() <= OUTPUT_LOW_WATERMARK) {
+        connection.reading_paused = false;
+        // Input may already be buffered, in our buffer or inside the TLS layer.
+        if (!process_input(connection)) {
+            return false;
+        }
+        ready |= Poller::Readable;
+    }
+
+    if ((ready & Poller::Readable) && !connection.reading_paused && !connection.close_when_flushed) {
+        if (!read_input(connection)) {
+            return false;
+        }
+    }
+
+    // Try to write the new responses right away instead of waiting for a writable event.
+    if (!connection.write_wants_read && !write_output(connection)) {
         return false;
     }
 
-    if (SSL_CTX_use_PrivateKey_file(ctx, key_path, SSL_FILETYPE_PEM) <= 0) {
-        std::cerr << "Error loading private key" << std::endl;
-        ERR_print_errors_fp(stderr);
+    if (connection.close_when_flushed && connection.output.empty()) {
+        if (connection.ssl) {
+            SSL_shutdown(connection.ssl);
+        }
+        return false;
+    }
+
+    update_interest(poller, connection);
+    return true;
+}
+
+// One round of the TLS handshake: runs until it needs the socket, has early data for the
+// event loop, or completes. It touches only the connection's TLS state and input, so it
+// can run on a handshake thread; handshake_stepped() acts on the outcome.
+void handshake_step(Connection& connection) {
+    connection.handshake_waiting = false;
+
+    const auto wait_or_fail = [&connection](const int error) {
+        switch (error) {
+            case SSL_ERROR_WANT_READ:
+                connection.handshake_waiting = true;
+                connection.handshake_wants_write = false;
+                break;
+            case SSL_ERROR_WANT_WRITE:
+                connection.handshake_waiting = true;
+                connection.handshake_wants_write = true;
+                break;
+            default:
+                // OpenSSL's error queue is per thread, so it is printed here.
+                std::cerr << "SSL accept failed." << std::endl;
+                ERR_print_errors_fp(stderr);
+                connection.handshake_failed = true;
+                break;
+        }
+    };
+
+    if (connection.reading_early_data) {
+        char buffer[READ_BUFFER_SIZE];
+        size_t received = 0;
+        ERR_clear_error();
+        const int result = SSL_read_early_data(connection.ssl, buffer, sizeof(buffer), &received);
+        if (result == SSL_READ_EARLY_DATA_ERROR) {
+            wait_or_fail(SSL_get_error(connection.ssl, 0));
+            return;
+        }
+
+        connection.input.append(buffer, received);
+        if (result == SSL_READ_EARLY_DATA_SUCCESS) {
+            return;
+        }
+        // Also when the client sent none or we rejected it: the handshake goes on as usual.
+        connection.reading_early_data = false;
+    }
+
+    ERR_clear_error();
+    const int result = SSL_accept(connection.ssl);
+    if (result == 1) {
+        connection.handshake_complete = true;
+        connection.handshake_wants_write = false;
+        return;
+    }
+    wait_or_fail(SSL_get_error(connection.ssl, result));
+}
+
+bool advance_handshake(Poller& poller, Connection& connection, HandshakePool* handshakes);
+
+// Acts on the outcome of a handshake step, on the event loop. Returns false once the
+// connection should be closed.
+bool handshake_stepped(Poller& poller, Connection& connection, HandshakePool* handshakes) {
+    if (connection.handshake_failed) {
         return false;
     }
 
-    if (!SSL_CTX_check_private_key(ctx)) {
-        std::cerr << "Private key does not match certificate" << std::endl;
-        ERR_print_errors_fp(stderr);
+    // Answer what early data brought in. Until the handshake completes only GET and HEAD
+    // go, their responses right behind the server's handshake flight.
+    if (!connection.input.empty() && (!process_input(connection) || !flush_output(connection))) {
         return false;
     }
 
+    if (connection.handshake_complete) {
+        if (handshakes) {
+            handshakes->release();
+        }
+        std::cout << "SSL connection established with client " << client_name(connection.address)
+                  << (SSL_get_early_data_status(connection.ssl) == SSL_EARLY_DATA_ACCEPTED ? " (0-RTT)" : "")
+                  << std::endl;
+        // The client may have sent its request right behind the Finished message.
+        return serve_connection(poller, connection, Poller::Readable);
+    }
+
+    if (!connection.handshake_waiting) {
+        return advance_handshake(poller, connection, handshakes);
+    }
+
+    update_interest(poller, connection);
     return true;
 }
 
-int server(
-    const int server_port,
-    const bool https,
-    const char* cert_path,
-    const char* key_path
-) {
+// Runs the next handshake step, on a handshake thread when there is a pool. The socket
+// then leaves the poller until the step is back, so nothing else touches the connection.
+bool advance_handshake(Poller& poller, Connection& connection, HandshakePool* handshakes) {
+    if (handshakes) {
+        poller.remove(connection.socket);
+        connection.interest = 0;
+        connection.handshake_busy = true;
+        handshakes->submit(connection.socket, [&connection] { handshake_step(connection); });
+        return true;
+    }
+
+    handshake_step(connection);
+    return handshake_stepped(poller, connection, nullptr);
+}
+
+// Advances a connection after a readiness event. Returns false once it should be closed.
+bool service_connection(Poller& poller, Connection& connection, const unsigned ready, HandshakePool* handshakes) {
+    if (!connection.handshake_complete) {
+        return advance_handshake(poller, connection, handshakes);
+    }
+    return serve_connection(poller, connection, ready);
+}
+
+// Reports the handshake pool's metrics for the last interval, if it did anything.
+void report_handshakes(HandshakePool& handshakes) {
+    const HandshakePool::Metrics metrics = handshakes.take_metrics();
+    if (metrics.steps == 0) {
+        return;
+    }
+
+    const auto steps = static_cast<long long>(metrics.steps);
+    std::cout << "Handshake pool: " << metrics.steps << " steps, up to " << metrics.in_flight_peak
+              << " connections and " << metrics.queue_peak << " queued steps; wait "
+              << metrics.wait.count() / steps << " us average, " << metrics.max_wait.count() << " us max; work "
+              << metrics.work.count() / steps << " us average." << std::endl;
+}
+
+// Pauses accepting at the connection limit or while the handshake pool is full, leaving
+// further clients in the kernel backlog, and switches request shedding on while the loop lags behind.
+void update_load(Poller& poller, const socket_t server_socket, const size_t connection_count,
+                 const HandshakePool* handshakes, const TimerWheel::clock::time_point iteration_start,
+                 const Config& config) {
+    const std::chrono::duration<double, std::milli> iteration = TimerWheel::clock::now() - iteration_start;
+    load.loop_lag_ms += LOOP_LAG_SMOOTHING * (iteration.count() - load.loop_lag_ms);
+
+    const bool at_capacity = (config.max_connections > 0 && connection_count >= config.max_connections) ||
+                             (handshakes && !handshakes->has_room());
+    if (at_capacity != load.accept_paused) {
+        load.accept_paused = at_capacity;
+        poller.modify(server_socket, at_capacity ? 0u : static_cast<unsigned>(Poller::Readable));
+        std::cerr << (at_capacity ? "Connection or handshake limit reached, pausing accept." : "Resuming accept.")
+                  << std::endl;
+    }
+
+    // Leave shedding only once lag has fallen well below the threshold, so it does not flap.
+    const double threshold = static_cast<double>(config.shed_lag.count());
+    const bool shedding = threshold > 0 &&
+                          (load.shedding ? load.loop_lag_ms > threshold / 2 : load.loop_lag_ms > threshold);
+    if (shedding != load.shedding) {
+        load.shedding = shedding;
+        std::cerr << (shedding ? "Event loop lagging, shedding requests with 503." : "Event loop recovered.")
+                  << " Lag " << static_cast<int>(load.loop_lag_ms) << " ms." << std::endl;
+    }
+}
+
+void accept_clients(Poller& poller, TimerWheel& timers, ConnectionMap& connections, const socket_t server_socket,
+                    HandshakePool* handshakes, const std::shared_ptr<const Settings>& settings) {
+    const Config& config = *settings->config;
+
+    // Stop at the connection limit or a full handshake pool; the rest waits in the backlog
+    // until update_load resumes accepting.
+    while ((config.max_connections == 0 || connections.size() < config.max_connections) &&
+           (!handshakes || handshakes->has_room())) {
+        sockaddr_in client_addr{};
+        socklen_t client_addr_size = sizeof(client_addr);
+        const socket_t client_socket = accept(server_socket, reinterpret_cast<sockaddr *>(&client_addr),
+                                              &client_addr_size);
+
+        if (client_socket == INVALID_SOCKET) {
+            if (SOCKET_WOULD_BLOCK()) {
+                return;
+            }
+            if (SOCKET_INTERRUPTED()) {
+                continue;
+            }
+            std::cerr << "Client " << client_name(client_addr) << " accepting failure." << std::endl;
+            return;
+        }
+
+        // Refuse abusive clients before spending a handshake or a lookup on them.
+        if (!load.rate_limiter->allow_connection(client_addr.sin_addr.s_addr, TimerWheel::clock::now())) {
+            std::cout << "Client " << client_name(client_addr) << " rate limited." << std::endl;
+            CLOSESOCKET(client_socket);
+            continue;
+        }
+
+        std::cout << "Client " << client_name(client_addr) << " connected." << std::endl;
+
+        auto connection = std::make_unique<Connection>();
+        connection->socket = client_socket;
+        connection->address = client_addr;
+        connection->settings = settings;
+
+        // Responses are coalesced in the output queue, so Nagle would only add latency.
+        int no_delay = 1;
+        setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char *>(&no_delay), sizeof(no_delay));
+
+        if (!set_nonblocking(client_socket)) {
+            std::cerr << "Unable to make client socket nonblocking." << std::endl;
+            continue;
+        }
+
+        if (settings->tls) {
+            connection->ssl = SSL_new(settings->tls->default_context());
+            SSL_set_fd(connection->ssl, static_cast<int>(client_socket));
+            connection->reading_early_data = config.max_early_data > 0;
+        } else {
+            connection->handshake_complete = true;
+        }
+
+        connection->interest = Poller::Readable;
+        if (!poller.add(client_socket, connection->interest)) {
+            std::cerr << "Unable to watch client socket." << std::endl;
+            continue;
+        }
+
+        // A fresh connection is held to the header deadline until its first request arrives.
+        connection->timer.owner = connection.get();
+        connection->deadline = Deadline::Header;
+        if (config.header_timeout > std::chrono::milliseconds::zero()) {
+            timers.schedule(connection->timer, config.header_timeout);
+        }
+
+        if (handshakes) {
+            handshakes->admit();
+        }
+        connections.emplace(client_socket, std::move(connection));
+    }
+}
+
+// Maps the archive at path, or returns null after reporting why it cannot.
+std::shared_ptr<const Archive> open_archive(const std::string& path) {
+    auto archive = Archive::open(path.c_str());
+    if (archive) {
+        std::cout << "Serving " << archive->size() << " paths from archive " << path << std::endl;
+    }
+    return archive;
+}
+
+// Runs on the reload thread: builds and publishes new settings, or keeps the running
+// ones if the new config or one of its certificates does not load.
+void reload_settings(const ConfigLoader& loader) {
+    const std::shared_ptr<const Settings> current = published_settings.load();
+    if (!current) {
+        return;
+    }
+
+    std::shared_ptr<const Config> config = loader();
+    if (!config) {
+        std::cerr << "Configuration reload failed, keeping the current configuration." << std::endl;
+        return;
+    }
+
+    // The listening socket stays as it is.
+    if (config->port != current->config->port || config->https != current->config->https) {
+        std::cerr << "Changing port or https needs a restart, keeping port " << current->config->port
+                  << (current->config->https ? " (HTTPS)." : " (HTTP).") << std::endl;
+        Config adjusted = *config;
+        adjusted.port = current->config->port;
+        adjusted.https = current->config->https;
+        config = std::make_shared<const Config>(std::move(adjusted));
+    }
+
+    std::shared_ptr<const TlsContexts> tls;
+    if (config->https) {
+        tls = TlsContexts::create(*config);
+        if (!tls) {
+            std::cerr << "Configuration reload failed, keeping the current configuration." << std::endl;
+            return;
+        }
+    }
+
+    // The archive is opened again even if its path stayed, so a repacked one is picked up.
+    // Only the configured path is opened; a failure keeps serving the current archive.
+    std::shared_ptr<const Archive> archive = current->archive;
+    if (config->archive_path.empty()) {
+        if (archive) {
+            std::cerr << "Serving the www directory instead of an archive needs a restart." << std::endl;
+        }
+    } else if (auto opened = open_archive(config->archive_path)) {
+        archive = std::move(opened);
+    } else {
+        std::cerr << "Archive reload failed, keeping the current archive." << std::endl;
+    }
+
+    published_settings.store(std::make_shared<const Settings>(
+        Settings{std::move(config), std::move(tls), std::move(archive)}));
+}
+
+// Runs on the event loop: rebuilds the state derived from the config. previous is null
+// the first time.
+void apply_settings(const Config* previous, const Config& config) {
+    load.shed_headers = "Retry-After: " + std::to_string(config.retry_after.count()) + "\r\n" +
+                        "Content-Length: 0\r\n";
+    load.shed_response = std::string(status_line(503)) + load.shed_headers + "Connection: close\r\n\r\n";
+
+    // Replacing the limiter forgets the buckets, so only do it when the limits change.
+    if (!previous ||
+        previous->connection_rate != config.connection_rate || previous->connection_burst != config.connection_burst ||
+        previous->request_rate != config.request_rate || previous->request_burst != config.request_burst) {
+        load.rate_limiter = std::make_unique<RateLimiter>(
+            RateLimiter::Limit{config.connection_rate, config.connection_burst},
+            RateLimiter::Limit{config.request_rate, config.request_burst});
+    }
+
+    if (previous && (previous->handshake_threads != config.handshake_threads ||
+                     previous->handshake_queue != config.handshake_queue)) {
+        std::cerr << "Resizing the handshake pool needs a restart." << std::endl;
+    }
+}
+
+int server(const ConfigLoader& loader) {
+    const std::shared_ptr<const Config> initial = loader();
+    if (!initial) {
+        return -1;
+    }
+
+    const int server_port = initial->port;
+    const bool https = initial->https;
+
     if (server_port < 0 || server_port > 65535) {
         std::cerr << "Invalid port number. Please use a port between 0 and 65535." << std::endl;
         return -1;
@@ -96,27 +1007,51 @@ int server(
 
     INIT_SOCKET();
 
-    SSL_CTX* ssl_ctx = nullptr;
+    webpage_handler_init();
 
-    if (https) {
-        init_openssl();
-        ssl_ctx = create_ssl_context();
-        if (!ssl_ctx) {
+    std::shared_ptr<const Archive> archive;
+    if (!initial->archive_path.empty()) {
+        archive = open_archive(initial->archive_path);
+        if (!archive) {
             CLEANUP_SOCKET();
             return -1;
         }
+        webpage_handler_set_archive(archive);
+    }
+
+#ifdef SIGHUP
+    install_reload_handler();
+#endif
 
-        if (!configure_ssl_context(ssl_ctx, cert_path, key_path)) {
-            SSL_CTX_free(ssl_ctx);
+#ifdef SIGPIPE
+    // Writes to a peer that has gone away must fail with EPIPE, not kill the process.
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+    std::shared_ptr<const TlsContexts> tls;
+
+    if (https) {
+        init_openssl();
+        tls = TlsContexts::create(*initial);
+        if (!tls) {
             cleanup_openssl();
             CLEANUP_SOCKET();
             return -1;
         }
 
-        std::cout << "HTTPS mode enabled. Using certificate: " << cert_path
-                  << " and key: " << key_path << std::endl;
+        std::cout << "HTTPS mode enabled. Using certificate: " << initial->cert_path
+                  << " and key: " << initial->key_path << std::endl;
+        if (!initial->ecdsa_cert_path.empty()) {
+            std::cout << "ECDSA certificate: " << initial->ecdsa_cert_path
+                      << " and key: " << initial->ecdsa_key_path << std::endl;
+        }
+        for (const CertificateConfig& certificate : initial->certificates) {
+            std::cout << "Serving " << certificate.host << " with certificate: " << certificate.cert_path << std::endl;
+        }
     }
 
+    published_settings.store(std::make_shared<const Settings>(Settings{initial, std::move(tls), std::move(archive)}));
+
     const socket_t server_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (server_socket == INVALID_SOCKET) {
         std::cerr << "Socket creation failed." << std::endl;
@@ -146,85 +1081,148 @@ int server(
         return -1;
     }
 
+    Poller poller;
+    if (!set_nonblocking(server_socket) || !poller.add(server_socket, Poller::Readable)) {
+        std::cerr << "Unable to watch the listening socket." << std::endl;
+        CLOSESOCKET(server_socket);
+        CLEANUP_SOCKET();
+        return -1;
+    }
+
     std::cout << "Server is listening on port " << server_port << " ("
               << (https ? "HTTPS" : "HTTP") << ")" << std::endl;
 
+    ConnectionMap connections;
+    std::vector<Poller::Event> events;
+    TimerWheel timers(TIMER_TICK);
+
+    // Handshakes run on their own threads; without HTTPS there are none.
+    std::unique_ptr<HandshakePool> handshakes;
+    if (https && initial->handshake_threads > 0) {
+        handshakes = std::make_unique<HandshakePool>(initial->handshake_threads, initial->handshake_queue, poller);
+    }
+    std::vector<socket_t> stepped;
+    auto next_report = TimerWheel::clock::now() + HANDSHAKE_REPORT_INTERVAL;
+
+    const auto close_connection = [&poller, &connections, &handshakes](const ConnectionMap::iterator it) {
+        if (handshakes && !it->second->handshake_complete) {
+            handshakes->release();
+        }
+        poller.remove(it->first);
+        connections.erase(it);
+    };
+
+    std::shared_ptr<const Settings> settings = published_settings.load();
+    apply_settings(nullptr, *settings->config);
+
+#ifdef SIGHUP
+    ConfigReloader reloader([&loader] { reload_settings(loader); });
+#endif
+
+    load.rate_limited_response = std::string(status_line(429)) + std::string(RATE_LIMITED_HEADERS) +
+                                 "Connection: close\r\n\r\n";
+
     while (true) {
         if (std::cin.eof()) {
             break;
         }
 
-        sockaddr_in client_addr{};
-        socklen_t client_addr_size = sizeof(client_addr);
-        const socket_t client_socket = accept(server_socket, reinterpret_cast<sockaddr *>(&client_addr),
-                                              &client_addr_size);
-
-        if (client_socket == INVALID_SOCKET) {
-            std::cerr << "Client " << inet_ntoa(client_addr.sin_addr) << ":"
-                    << ntohs(client_addr.sin_port) << " accepting failure." << std::endl;
-            continue;
+#ifdef SIGHUP
+        if (reload_requested) {
+            reload_requested = 0;
+            reloader.request();
         }
+#endif
 
-        std::cout << "Client " << inet_ntoa(client_addr.sin_addr) << ":"
-                << ntohs(client_addr.sin_port) << " connected." << std::endl;
+        int wait_ms = timers.next_timeout_ms(TimerWheel::clock::now());
+        if (wait_ms < 0 || wait_ms > MAX_WAIT_MS) {
+            wait_ms = MAX_WAIT_MS;
+        }
 
-        SSL* ssl = nullptr;
+        if (poller.wait(events, wait_ms) < 0 && !SOCKET_INTERRUPTED()) {
+            std::cerr << "Waiting for socket events failed." << std::endl;
+            break;
+        }
 
-        if (https) {
-            ssl = SSL_new(ssl_ctx);
-            SSL_set_fd(ssl, client_socket);
+        const auto iteration_start = TimerWheel::clock::now();
 
-            if (SSL_accept(ssl) <= 0) {
-                std::cerr << "SSL accept failed." << std::endl;
-                ERR_print_errors_fp(stderr);
-                SSL_free(ssl);
-                CLOSESOCKET(client_socket);
-                continue;
+        // New connections use the latest settings; existing ones keep the snapshot they hold.
+        if (auto latest = published_settings.load(); latest != settings) {
+            apply_settings(settings->config.get(), *latest->config);
+            if (latest->archive != settings->archive) {
+                webpage_handler_set_archive(latest->archive);
             }
-
-            std::cout << "SSL connection established with client "
-                      << inet_ntoa(client_addr.sin_addr) << ":"
-                      << ntohs(client_addr.sin_port) << std::endl;
+            settings = std::move(latest);
+            std::cout << "Configuration reloaded." << std::endl;
         }
 
-        char buffer[1024];
-        int bytes_received;
+        // Connections whose handshake step is back from the pool rejoin the poller.
+        if (handshakes) {
+            handshakes->take_finished(stepped);
+            for (const socket_t socket : stepped) {
+                const auto it = connections.find(socket);
+                Connection& connection = *it->second;
+                connection.handshake_busy = false;
+                poller.add(socket, 0);
 
-        if (https) {
-            bytes_received = SSL_read(ssl, buffer, sizeof(buffer) - 1);
-        } else {
-            bytes_received = recv(client_socket, buffer, sizeof(buffer) - 1, 0);
-        }
+                if (connection.timed_out || !handshake_stepped(poller, connection, handshakes.get())) {
+                    close_connection(it);
+                    continue;
+                }
 
-        if (bytes_received > 0) {
-            buffer[bytes_received] = '\0';
-            std::string request(buffer);
+                refresh_deadline(timers, connection);
+            }
+        }
 
-            std::string url = request.substr(request.find(' ') + 1);
-            url = url.substr(0, url.find(' '));
-            std::cout << "Extracted URL: " << url << std::endl;
+        for (const auto& [socket, ready] : events) {
+            if (socket == server_socket) {
+                accept_clients(poller, timers, connections, server_socket, handshakes.get(), settings);
+                continue;
+            }
 
-            std::string response = webpage_handler(url);
+            const auto it = connections.find(socket);
+            if (it == connections.end()) {
+                continue;
+            }
 
-            if (https) {
-                SSL_write(ssl, response.c_str(), static_cast<int>(response.length()));
-            } else {
-                send(client_socket, response.c_str(), static_cast<int>(response.length()), 0);
+            if (!service_connection(poller, *it->second, ready, handshakes.get())) {
+                close_connection(it);
+                continue;
             }
-        } else {
-            std::cerr << "Failed to receive data from client." << std::endl;
-        }
 
-        if (https && ssl) {
-            SSL_shutdown(ssl);
-            SSL_free(ssl);
+            refresh_deadline(timers, *it->second);
         }
 
-        CLOSESOCKET(client_socket);
+        timers.advance(TimerWheel::clock::now(), [&connections, &close_connection](TimerWheel::Timer& timer) {
+            auto* connection = static_cast<Connection*>(timer.owner);
+            if (connection->deadline != Deadline::Idle) {
+                std::cout << "Client " << client_name(connection->address) << " timed out ("
+                          << deadline_name(connection->deadline) << ")." << std::endl;
+            }
+            // A handshake thread still holds it; it closes once the step is back.
+            if (connection->handshake_busy) {
+                connection->timed_out = true;
+                return;
+            }
+            close_connection(connections.find(connection->socket));
+        });
+
+        update_load(poller, server_socket, connections.size(), handshakes.get(), iteration_start, *settings->config);
+        load.rate_limiter->age(TimerWheel::clock::now());
+
+        if (handshakes && iteration_start >= next_report) {
+            report_handshakes(*handshakes);
+            next_report = iteration_start + HANDSHAKE_REPORT_INTERVAL;
+        }
     }
 
+    // Stop the handshake threads before the connections they work on go.
+    handshakes.reset();
+    connections.clear();
+    settings.reset();
+    published_settings.store(nullptr);
+
     if (https) {
-        SSL_CTX_free(ssl_ctx);
         cleanup_openssl();
     }
 
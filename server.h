@@ -1,6 +1,15 @@
 #ifndef SERVER_H
 #define SERVER_H
 
-int server(int server_port, bool https, const char* cert_path, const char* key_path);
+#include "config.h"
 
-#endif // SERVER_H
\ No newline at end of file
+#include <functional>
+#include <memory>
+
+// Builds a complete config, or returns null if it is invalid. The server calls it once at
+// startup and again on a background thread for every reload (SIGHUP).
+using ConfigLoader = std::function<std::shared_ptr<const Config>()>;
+
+int server(const ConfigLoader& loader);
+
+#endif // SERVER_H
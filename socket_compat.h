@@ -0,0 +1,49 @@
+#ifndef SOCKET_COMPAT_H
+#define SOCKET_COMPAT_H
+
+#include <iostream>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    using socket_t = SOCKET;
+    #define CLOSESOCKET closesocket
+    #define INIT_SOCKET() \
+        WSADATA wsaData; \
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) { \
+            std::cerr << "WSAStartup failed." << std::endl; \
+            return -1; \
+        }
+    #define CLEANUP_SOCKET() WSACleanup()
+    #define SOCKET_WOULD_BLOCK() (WSAGetLastError() == WSAEWOULDBLOCK)
+    #define SOCKET_INTERRUPTED() (WSAGetLastError() == WSAEINTR)
+#else
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+using socket_t = int;
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#define CLOSESOCKET close
+#define INIT_SOCKET()
+#define CLEANUP_SOCKET()
+#define SOCKET_WOULD_BLOCK() (errno == EAGAIN || errno == EWOULDBLOCK)
+#define SOCKET_INTERRUPTED() (errno == EINTR)
+#endif
+
+inline bool set_nonblocking(const socket_t socket) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+    const int flags = fcntl(socket, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+#endif // SOCKET_COMPAT_H
@@ -0,0 +1,107 @@
+# Regression test for TLS writes that stall: a client that stops reading for longer than
+# the record size idle reset must still receive the whole response. A write retried with a
+# different length than the one OpenSSL is holding fails with "bad length" and drops the
+# connection partway through the body.
+#
+# Run by CTest as: tls_slow_reader.py <jella binary> <openssl binary>
+
+import os
+import socket
+import ssl
+import subprocess
+import sys
+import tempfile
+import time
+
+# Larger than the kernel lets a loopback send buffer grow to (4 MB by default), so the
+# server's writes stall while the client pauses.
+BODY_SIZE = 16 * 1000 * 1000
+RECEIVE_BUFFER = 4096
+READ_BEFORE_PAUSE = 256 * 1024
+PAUSE_SECONDS = 2.5     # Longer than TLS_RECORD_IDLE_RESET.
+
+
+def free_port():
+    with socket.socket() as probe:
+        probe.bind(("127.0.0.1", 0))
+        return probe.getsockname()[1]
+
+
+def wait_for_port(port, server):
+    deadline = time.monotonic() + 10
+    while time.monotonic() < deadline:
+        if server.poll() is not None:
+            sys.exit("jella exited early with status %d" % server.returncode)
+        try:
+            socket.create_connection(("127.0.0.1", port), timeout=1).close()
+            return
+        except OSError:
+            time.sleep(0.1)
+    sys.exit("jella did not start listening on port %d" % port)
+
+
+def fetch_slowly(port):
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+    context.check_hostname = False
+    context.verify_mode = ssl.CERT_NONE
+
+    raw = socket.socket()
+    raw.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, RECEIVE_BUFFER)
+    raw.settimeout(30)
+    raw.connect(("127.0.0.1", port))
+
+    with context.wrap_socket(raw, server_hostname="localhost") as client:
+        client.sendall(b"GET /big.bin HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n")
+
+        response = bytearray()
+        paused = False
+        while True:
+            if not paused and len(response) >= READ_BEFORE_PAUSE:
+                time.sleep(PAUSE_SECONDS)
+                paused = True
+            try:
+                data = client.recv(RECEIVE_BUFFER)
+            except (ssl.SSLError, ConnectionError) as error:
+                sys.exit("connection failed after %d bytes: %s" % (len(response), error))
+            if not data:
+                return bytes(response)
+            response += data
+
+
+def main():
+    jella, openssl = sys.argv[1], sys.argv[2]
+
+    with tempfile.TemporaryDirectory() as directory:
+        subprocess.run([openssl, "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-days", "1",
+                        "-subj", "/CN=localhost", "-keyout", "server.key", "-out", "server.crt"],
+                       cwd=directory, check=True, capture_output=True)
+
+        os.mkdir(os.path.join(directory, "www"))
+        body = os.urandom(BODY_SIZE)
+        with open(os.path.join(directory, "www", "big.bin"), "wb") as file:
+            file.write(body)
+
+        port = free_port()
+        with open(os.path.join(directory, "config.yaml"), "w") as file:
+            file.write("port: %d\nhttps: true\nhttp2: false\n" % port)
+
+        # jella stops once its standard input ends, so it gets a pipe that stays open.
+        server = subprocess.Popen([jella, "--config", "config.yaml"], cwd=directory,
+                                  stdin=subprocess.PIPE, stdout=subprocess.DEVNULL)
+        try:
+            wait_for_port(port, server)
+            response = fetch_slowly(port)
+        finally:
+            server.kill()
+            server.wait()
+
+    head, _, received = response.partition(b"\r\n\r\n")
+    if not head.startswith(b"HTTP/1.1 200"):
+        sys.exit("unexpected response: %r" % head[:100])
+    if received != body:
+        sys.exit("received %d of %d body bytes" % (len(received), BODY_SIZE))
+    print("received all %d bytes after a %.1f s pause" % (BODY_SIZE, PAUSE_SECONDS))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,103 @@
+#include "timer_wheel.h"
+
+#include <algorithm>
+
+TimerWheel::Timer::~Timer() {
+    if (wheel) {
+        wheel->cancel(*this);
+    }
+}
+
+TimerWheel::TimerWheel(const std::chrono::milliseconds tick, const clock::time_point now) :
+    tick(std::max(tick, std::chrono::milliseconds(1))),
+    start(now) {
+    for (auto& level : slots) {
+        for (Timer& sentinel : level) {
+            sentinel.prev = &sentinel;
+            sentinel.next = &sentinel;
+        }
+    }
+}
+
+void TimerWheel::schedule(Timer& timer, const std::chrono::milliseconds delay) {
+    if (timer.wheel) {
+        cancel(timer);
+    }
+
+    // Round up so a timer never fires early, and always at least one tick ahead.
+    const auto ticks = std::max<int64_t>((delay.count() + tick.count() - 1) / tick.count(), 1);
+
+    timer.expires = current_tick + std::min<uint64_t>(static_cast<uint64_t>(ticks), MAX_TICKS);
+    timer.wheel = this;
+    ++armed_count;
+    insert(timer);
+}
+
+void TimerWheel::cancel(Timer& timer) {
+    if (timer.wheel != this) {
+        return;
+    }
+
+    timer.prev->next = timer.next;
+    timer.next->prev = timer.prev;
+    timer.prev = timer.next = nullptr;
+    timer.wheel = nullptr;
+    --armed_count;
+}
+
+void TimerWheel::insert(Timer& timer) {
+    const uint64_t delta = timer.expires > current_tick ? timer.expires - current_tick : 0;
+
+    unsigned level = 0;
+    while (level + 1 < LEVELS && delta >= (uint64_t{1} << (SLOT_BITS * (level + 1)))) {
+        ++level;
+    }
+
+    Timer& sentinel = slots[level][(timer.expires >> (SLOT_BITS * level)) & SLOT_MASK];
+    timer.prev = sentinel.prev;
+    timer.next = &sentinel;
+    sentinel.prev->next = &timer;
+    sentinel.prev = &timer;
+}
+
+void TimerWheel::cascade(const unsigned level) {
+    Timer& sentinel = slots[level][(current_tick >> (SLOT_BITS * level)) & SLOT_MASK];
+
+    // Detach the whole slot first: re-inserted timers land in lower levels.
+    Timer* timer = sentinel.next;
+    sentinel.prev->next = nullptr;
+    sentinel.prev = sentinel.next = &sentinel;
+
+    while (timer && timer != &sentinel) {
+        Timer* next = timer->next;
+        insert(*timer);
+        timer = next;
+    }
+}
+
+uint64_t TimerWheel::tick_of(const clock::time_point time) const {
+    if (time <= start) {
+        return 0;
+    }
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(time - start) / tick);
+}
+
+int TimerWheel::next_timeout_ms(const clock::time_point now) const {
+    if (armed_count == 0) {
+        return -1;
+    }
+
+    // The nearest non-empty slot in the lowest level; otherwise the next cascade.
+    uint64_t ticks = SLOTS - (current_tick & SLOT_MASK);
+    for (uint64_t distance = 1; distance < SLOTS; ++distance) {
+        const Timer& sentinel = slots[0][(current_tick + distance) & SLOT_MASK];
+        if (sentinel.next != &sentinel) {
+            ticks = distance;
+            break;
+        }
+    }
+
+    const auto due = start + tick * static_cast<int64_t>(current_tick + ticks);
+    const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(due - now).count();
+    return static_cast<int>(std::clamp<int64_t>(remaining + 1, 0, 60 * 60 * 1000));
+}
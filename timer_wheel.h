@@ -0,0 +1,105 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <chrono>
+#include <cstdint>
+
+// Hierarchical hashed timer wheel: four levels of 64 slots each, so scheduling,
+// rescheduling and cancelling are O(1) and a tick only touches one slot, plus an
+// occasional cascade of a higher-level slot into the levels below it.
+// Timers are intrusive; their owners embed them and no allocation happens.
+class TimerWheel {
+public:
+    using clock = std::chrono::steady_clock;
+
+    class Timer {
+    public:
+        Timer() = default;
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+        ~Timer();
+
+        [[nodiscard]] bool armed() const { return wheel != nullptr; }
+
+        void* owner = nullptr;
+
+    private:
+        friend class TimerWheel;
+
+        Timer* prev = nullptr;
+        Timer* next = nullptr;
+        TimerWheel* wheel = nullptr;
+        uint64_t expires = 0;
+    };
+
+    explicit TimerWheel(std::chrono::milliseconds tick, clock::time_point now = clock::now());
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // Longest delay a wheel with this tick holds; schedule() cuts longer ones short.
+    static constexpr std::chrono::milliseconds max_delay(const std::chrono::milliseconds tick) {
+        return tick * static_cast<int64_t>(MAX_TICKS);
+    }
+
+    // Arms the timer to fire after delay, replacing any pending deadline.
+    void schedule(Timer& timer, std::chrono::milliseconds delay);
+    void cancel(Timer& timer);
+
+    // Runs every tick up to now, calling on_expired(timer) for each timer that is
+    // due. Expired timers are disarmed first, so the callback may re-arm or destroy them.
+    template<typename Callback>
+    void advance(clock::time_point now, Callback&& on_expired);
+
+    // Milliseconds until the next timer is due, or -1 when nothing is armed.
+    [[nodiscard]] int next_timeout_ms(clock::time_point now) const;
+
+private:
+    static constexpr unsigned LEVELS = 4;
+    static constexpr unsigned SLOT_BITS = 6;
+    static constexpr unsigned SLOTS = 1u << SLOT_BITS;
+    static constexpr uint64_t SLOT_MASK = SLOTS - 1;
+    static constexpr uint64_t MAX_TICKS = (uint64_t{1} << (SLOT_BITS * LEVELS)) - 1;
+
+    void insert(Timer& timer);
+    void cascade(unsigned level);
+    uint64_t tick_of(clock::time_point time) const;
+
+    std::chrono::milliseconds tick;
+    clock::time_point start;
+    uint64_t current_tick = 0;
+    size_t armed_count = 0;
+
+    // Each slot is a circular list around a sentinel node.
+    Timer slots[LEVELS][SLOTS];
+};
+
+template<typename Callback>
+void TimerWheel::advance(const clock::time_point now, Callback&& on_expired) {
+    const uint64_t target = tick_of(now);
+
+    while (current_tick < target) {
+        if (armed_count == 0) {
+            current_tick = target;
+            break;
+        }
+
+        ++current_tick;
+
+        for (unsigned level = 1; level < LEVELS; ++level) {
+            if ((current_tick & ((uint64_t{1} << (SLOT_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            cascade(level);
+        }
+
+        Timer& slot = slots[0][current_tick & SLOT_MASK];
+        while (slot.next != &slot) {
+            Timer* timer = slot.next;
+            cancel(*timer);
+            on_expired(*timer);
+        }
+    }
+}
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,246 @@
+#include "tls_context.h"
+
+#include <cctype>
+#include <iostream>
+
+#include <openssl/err.h>
+
+namespace {
+    // TLS 1.2 suites: forward secret AEAD only, ECDSA before RSA because it is the cheaper
+    // signature. Both lists put AES-128 first, which is as safe and cheaper than AES-256.
+    constexpr const char* TLS12_CIPHERS =
+        "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:"
+        "ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-RSA-AES256-GCM-SHA384:"
+        "ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-RSA-CHACHA20-POLY1305";
+    constexpr const char* TLS13_CIPHERS = "TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384:TLS_CHACHA20_POLY1305_SHA256";
+
+    // Key exchange groups, X25519 first: the fastest, and what clients send a key share for.
+    constexpr const char* GROUPS = "X25519:P-256:P-384";
+
+    // ALPN: HTTP/2 for clients that offer it, HTTP/1.1 for the others. The TLS 1.2 suites
+    // above are all ones HTTP/2 allows (RFC 9113 section 9.2).
+    constexpr unsigned char PROTOCOLS[] = "\x02h2\x08http/1.1";
+
+    int select_protocol(SSL*, const unsigned char** out, unsigned char* out_length, const unsigned char* in,
+                        const unsigned int in_length, void*) {
+        unsigned char* selected = nullptr;
+        if (SSL_select_next_proto(&selected, out_length, PROTOCOLS, sizeof(PROTOCOLS) - 1, in, in_length) !=
+            OPENSSL_NPN_NEGOTIATED) {
+            return SSL_TLSEXT_ERR_NOACK;
+        }
+        *out = selected;
+        return SSL_TLSEXT_ERR_OK;
+    }
+
+    SSL_CTX* create_ssl_context(const uint32_t max_early_data, const bool http2) {
+        const SSL_METHOD* method = TLS_server_method();
+        SSL_CTX* ctx = SSL_CTX_new(method);
+
+        if (!ctx) {
+            std::cerr << "Unable to create SSL context." << std::endl;
+            ERR_print_errors_fp(stderr);
+            return nullptr;
+        }
+
+        // Output is written from per-connection queues on nonblocking sockets: let
+        // SSL_write() report partial progress and accept a retry from a moved buffer.
+        SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+        // Our preference order decides, except that clients preferring ChaCha20 (no AES
+        // hardware) get it.
+        SSL_CTX_set_options(ctx, SSL_OP_CIPHER_SERVER_PREFERENCE | SSL_OP_PRIORITIZE_CHACHA);
+
+        if (!SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION) ||
+            !SSL_CTX_set_cipher_list(ctx, TLS12_CIPHERS) ||
+            !SSL_CTX_set_ciphersuites(ctx, TLS13_CIPHERS) ||
+            !SSL_CTX_set1_groups_list(ctx, GROUPS)) {
+            std::cerr << "Unable to set the TLS protocol, cipher and group lists." << std::endl;
+            ERR_print_errors_fp(stderr);
+            SSL_CTX_free(ctx);
+            return nullptr;
+        }
+
+        // 0-RTT data can be replayed. OpenSSL's anti-replay keeps every ticket it issues in
+        // the server session cache and accepts early data under it only once, within the
+        // ticket's lifetime and with a matching ticket age, so a replayed first flight falls
+        // back to a full handshake.
+        if (max_early_data > 0 &&
+            (!SSL_CTX_set_max_early_data(ctx, max_early_data) || !SSL_CTX_set_recv_max_early_data(ctx, max_early_data))) {
+            std::cerr << "Unable to enable TLS early data." << std::endl;
+            ERR_print_errors_fp(stderr);
+            SSL_CTX_free(ctx);
+            return nullptr;
+        }
+
+        // The servername callback may switch a handshake to another context before ALPN runs,
+        // so every context selects the protocol.
+        if (http2) {
+            SSL_CTX_set_alpn_select_cb(ctx, select_protocol, nullptr);
+        }
+
+        return ctx;
+    }
+
+    bool use_certificate(SSL_CTX* ctx, const char* cert_path, const char* key_path) {
+        if (SSL_CTX_use_certificate_file(ctx, cert_path, SSL_FILETYPE_PEM) <= 0) {
+            std::cerr << "Error loading certificate " << cert_path << std::endl;
+            ERR_print_errors_fp(stderr);
+            return false;
+        }
+
+        if (SSL_CTX_use_PrivateKey_file(ctx, key_path, SSL_FILETYPE_PEM) <= 0) {
+            std::cerr << "Error loading private key " << key_path << std::endl;
+            ERR_print_errors_fp(stderr);
+            return false;
+        }
+
+        if (!SSL_CTX_check_private_key(ctx)) {
+            std::cerr << "Private key " << key_path << " does not match certificate " << cert_path << std::endl;
+            ERR_print_errors_fp(stderr);
+            return false;
+        }
+
+        return true;
+    }
+
+    // Whether the certificate loaded last has an EC key.
+    bool current_is_ecdsa(SSL_CTX* ctx) {
+        return EVP_PKEY_is_a(X509_get0_pubkey(SSL_CTX_get0_certificate(ctx)), "EC");
+    }
+
+    // OpenSSL keeps one certificate per key type in a context, so an RSA and an ECDSA
+    // certificate sit side by side and each handshake gets the best one the client can use.
+    bool configure_ssl_context(SSL_CTX* ctx, const std::string& cert_path, const std::string& key_path,
+                               const std::string& ecdsa_cert_path, const std::string& ecdsa_key_path,
+                               OcspStapler& stapler) {
+        if (!use_certificate(ctx, cert_path.c_str(), key_path.c_str())) {
+            return false;
+        }
+        stapler.add(SSL_CTX_get0_certificate(ctx), cert_path);
+
+        if (ecdsa_cert_path.empty()) {
+            return true;
+        }
+
+        // Otherwise the ECDSA certificate would replace it rather than go next to it.
+        if (current_is_ecdsa(ctx)) {
+            std::cerr << "Certificate " << cert_path << " is an ECDSA one too; put the RSA one next to "
+                      << ecdsa_cert_path << std::endl;
+            return false;
+        }
+
+        if (!use_certificate(ctx, ecdsa_cert_path.c_str(), ecdsa_key_path.c_str())) {
+            return false;
+        }
+
+        if (!current_is_ecdsa(ctx)) {
+            std::cerr << "Certificate " << ecdsa_cert_path << " is not an ECDSA certificate" << std::endl;
+            return false;
+        }
+        stapler.add(SSL_CTX_get0_certificate(ctx), ecdsa_cert_path);
+
+        return true;
+    }
+
+    std::string lower_case(const std::string_view name) {
+        std::string lower(name);
+        for (char& c : lower) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return lower;
+    }
+}
+
+std::shared_ptr<const TlsContexts> TlsContexts::create(const Config& config) {
+    std::shared_ptr<TlsContexts> tls(new TlsContexts());
+
+    const auto load = [&tls, &config](const std::string& cert_path, const std::string& key_path,
+                             const std::string& ecdsa_cert_path, const std::string& ecdsa_key_path) -> SSL_CTX* {
+        SSL_CTX* ctx = create_ssl_context(config.max_early_data, config.http2);
+        if (!ctx) {
+            return nullptr;
+        }
+        tls->contexts.emplace_back(ctx);
+        return configure_ssl_context(ctx, cert_path, key_path, ecdsa_cert_path, ecdsa_key_path, tls->stapler)
+                   ? ctx
+                   : nullptr;
+    };
+
+    SSL_CTX* default_ctx = load(config.cert_path, config.key_path, config.ecdsa_cert_path, config.ecdsa_key_path);
+    if (!default_ctx) {
+        return nullptr;
+    }
+
+    for (const CertificateConfig& certificate : config.certificates) {
+        // Hosts sharing the default certificates share its context.
+        const bool same_as_default = certificate.cert_path == config.cert_path &&
+                                     certificate.key_path == config.key_path &&
+                                     certificate.ecdsa_cert_path == config.ecdsa_cert_path &&
+                                     certificate.ecdsa_key_path == config.ecdsa_key_path;
+        SSL_CTX* ctx = same_as_default
+                           ? default_ctx
+                           : load(certificate.cert_path, certificate.key_path,
+                                  certificate.ecdsa_cert_path, certificate.ecdsa_key_path);
+        if (!ctx) {
+            return nullptr;
+        }
+        tls->hosts.emplace(lower_case(certificate.host), ctx);
+    }
+
+    // Only the default context sees the ClientHello, so only it needs the callback.
+    if (!tls->hosts.empty()) {
+        SSL_CTX_set_tlsext_servername_callback(default_ctx, select_context);
+        SSL_CTX_set_tlsext_servername_arg(default_ctx, tls.get());
+    }
+
+    for (const auto& ctx : tls->contexts) {
+        tls->stapler.attach(ctx.get());
+    }
+    tls->stapler.start();
+
+    return tls;
+}
+
+SSL_CTX* TlsContexts::find(const std::string_view server_name) const {
+    std::string name = lower_case(server_name);
+
+    if (const auto it = hosts.find(name); it != hosts.end()) {
+        return it->second;
+    }
+
+    // A wildcard stands for exactly one label, so "*.example.com" covers "www.example.com"
+    // but neither "example.com" nor "a.www.example.com".
+    const size_t dot = name.find('.');
+    if (dot == std::string::npos || dot == 0) {
+        return nullptr;
+    }
+    name.replace(0, dot, "*");
+
+    if (const auto it = hosts.find(name); it != hosts.end()) {
+        return it->second;
+    }
+    return nullptr;
+}
+
+int TlsContexts::select_context(SSL* ssl, int*, void* arg) {
+    const char* server_name = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    if (!server_name) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+
+    // An unknown name is not an error: the client gets the default certificate and decides.
+    if (SSL_CTX* ctx = static_cast<const TlsContexts*>(arg)->find(server_name)) {
+        SSL_set_SSL_CTX(ssl, ctx);
+    }
+    return SSL_TLSEXT_ERR_OK;
+}
+
+void init_openssl() {
+    SSL_load_error_strings();
+    OpenSSL_add_ssl_algorithms();
+}
+
+void cleanup_openssl() {
+    ERR_free_strings();
+    EVP_cleanup();
+}
@@ -0,0 +1,51 @@
+#ifndef TLS_CONTEXT_H
+#define TLS_CONTEXT_H
+
+#include "config.h"
+#include "ocsp_stapler.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <openssl/ssl.h>
+
+// The server's TLS contexts, all loaded up front: a default one from cert/key and one
+// per entry in certificates. Handshakes start on the default context; a servername
+// callback then switches them to the context of the host the client named (SNI), and
+// each certificate with an OCSP response file gets it stapled. ALPN offers HTTP/2 unless
+// the config turns it off.
+class TlsContexts {
+public:
+    TlsContexts(const TlsContexts&) = delete;
+    TlsContexts& operator=(const TlsContexts&) = delete;
+
+    // Loads every certificate in config. Failures are reported to std::cerr and give null.
+    static std::shared_ptr<const TlsContexts> create(const Config& config);
+
+    [[nodiscard]] SSL_CTX* default_context() const { return contexts.front().get(); }
+
+    // Context for a server name: an exact host first, then a "*." wildcard covering its
+    // first label. Null when no certificate matches.
+    [[nodiscard]] SSL_CTX* find(std::string_view server_name) const;
+
+private:
+    TlsContexts() = default;
+
+    static int select_context(SSL* ssl, int* alert, void* arg);
+
+    struct ContextDeleter {
+        void operator()(SSL_CTX* ctx) const { SSL_CTX_free(ctx); }
+    };
+
+    std::vector<std::unique_ptr<SSL_CTX, ContextDeleter>> contexts;  // Default first.
+    std::unordered_map<std::string, SSL_CTX*> hosts;                  // Lower-case names, wildcards as "*.example.com".
+    OcspStapler stapler;                                              // Declared last: stops before the contexts go.
+};
+
+void init_openssl();
+void cleanup_openssl();
+
+#endif // TLS_CONTEXT_H
@@ -1,28 +1,123 @@
 #include "webpage_handler.h"
+#include "archive.h"
+#include "early_hints.h"
 #include "mime_types_data.h"
+#ifdef JELLA_EMBED_WWW
+#include "www_data.h"
+#endif
 
 #include <string>
 #include <fstream>
+#include <iostream>
 #include <unordered_map>
 #include <filesystem>
+#include <chrono>
+#include <deque>
+#include <atomic>
+#include <sstream>
+#include <vector>
 
-std::string content_type(const std::string &file_extension) {
-    std::unordered_map<std::string, std::string> mime_types;
+namespace {
+#ifndef JELLA_EMBED_WWW
+    // Paths that missed are remembered for a short while so that scanners probing
+    // nonexistent URLs do not cost a filesystem lookup per request. The TTL keeps
+    // files added to "www" at runtime visible without a restart.
+    constexpr size_t NEGATIVE_CACHE_CAPACITY = 4096;
+    constexpr size_t NEGATIVE_CACHE_MAX_KEY_LENGTH = 512;
+    constexpr auto NEGATIVE_CACHE_TTL = std::chrono::seconds(10);
+
+    using steady_clock = std::chrono::steady_clock;
+
+    std::unordered_map<std::string, steady_clock::time_point> negative_cache;
+    std::deque<std::string> negative_cache_order;
+#endif
+
+    struct OwnedContent {
+        std::string headers;
+        std::string body;
+        std::string links;
+    };
+
+    std::shared_ptr<const OwnedContent> not_found_content;
+
+    // The archive is swapped as a whole on reload; responses in flight keep the
+    // previous mapping alive through WebResponse::storage.
+    std::atomic<std::shared_ptr<const Archive>> current_archive;
+
+#ifdef JELLA_EMBED_WWW
+    // Header lines and preload links for the compiled-in files, indexed like embedded::WWW_FILES.
+    std::vector<std::string> embedded_headers;
+    std::vector<std::string> embedded_links;
+
+    const embedded::WwwFile* find_embedded_file(const std::string_view url) {
+        const std::string_view path = url.substr(0, url.find('?'));
+
+        if (path.ends_with('/')) {
+            return embedded::find_www_file(std::string(path) + "index.html");
+        }
+
+        if (const auto* file = embedded::find_www_file(path)) {
+            return file;
+        }
+
+        return embedded::find_www_file(std::string(path) + ".html");
+    }
+#endif
+
+    WebResponse not_found_response() {
+        return {404, not_found_content->headers, not_found_content->body, not_found_content, {}};
+    }
 
-    std::istringstream csv_stream(embedded::MIME_TYPES_CSV);
-    std::string line;
+#ifndef JELLA_EMBED_WWW
+    bool negative_cache_contains(const std::string &url) {
+        const auto it = negative_cache.find(url);
+        return it != negative_cache.end() && steady_clock::now() - it->second <= NEGATIVE_CACHE_TTL;
+    }
 
-    std::getline(csv_stream, line);
+    void negative_cache_insert(const std::string &url) {
+        if (url.size() > NEGATIVE_CACHE_MAX_KEY_LENGTH) {
+            return;
+        }
 
-    while (std::getline(csv_stream, line)) {
-        std::stringstream line_stream(line);
-        std::string extension, mime_type;
+        // Expired entries are refreshed in place and otherwise age out in FIFO order,
+        // so the map and the eviction queue always hold the same keys.
+        if (const auto it = negative_cache.find(url); it != negative_cache.end()) {
+            it->second = steady_clock::now();
+            return;
+        }
 
-        std::getline(line_stream, extension, ',');
-        std::getline(line_stream, mime_type, ',');
+        if (negative_cache.size() >= NEGATIVE_CACHE_CAPACITY) {
+            negative_cache.erase(negative_cache_order.front());
+            negative_cache_order.pop_front();
+        }
 
-        mime_types[extension] = mime_type;
+        negative_cache.emplace(url, steady_clock::now());
+        negative_cache_order.push_back(url);
     }
+#endif
+}
+
+std::string content_type(const std::string &file_extension) {
+    static const std::unordered_map<std::string, std::string> mime_types = [] {
+        std::unordered_map<std::string, std::string> table;
+
+        std::istringstream csv_stream(embedded::MIME_TYPES_CSV);
+        std::string line;
+
+        std::getline(csv_stream, line);
+
+        while (std::getline(csv_stream, line)) {
+            std::stringstream line_stream(line);
+            std::string extension, mime_type;
+
+            std::getline(line_stream, extension, ',');
+            std::getline(line_stream, mime_type, ',');
+
+            table[extension] = mime_type;
+        }
+
+        return table;
+    }();
 
     std::string ext;
 
@@ -30,12 +125,104 @@ std::string content_type(const std::string &file_extension) {
         ext = ext.substr(1);
     }
 
-    return mime_types.contains(ext) ? mime_types[ext] : "application/octet-stream";
+    const auto it = mime_types.find(ext);
+    return it != mime_types.end() ? it->second : "application/octet-stream";
+}
+
+std::string_view status_line(const int status) {
+    switch (status) {
+        case 103:
+            return "HTTP/1.1 103 Early Hints\r\n";
+        case 200:
+            return "HTTP/1.1 200 OK\r\n";
+        case 400:
+            return "HTTP/1.1 400 Bad Request\r\n";
+        case 404:
+            return "HTTP/1.1 404 Not Found\r\n";
+        case 429:
+            return "HTTP/1.1 429 Too Many Requests\r\n";
+        case 503:
+            return "HTTP/1.1 503 Service Unavailable\r\n";
+        default:
+            return "HTTP/1.1 500 Internal Server Error\r\n";
+    }
+}
+
+void webpage_handler_init() {
+    auto content = std::make_shared<OwnedContent>();
+    const auto archive = current_archive.load();
+
+#ifdef JELLA_EMBED_WWW
+    if (embedded_headers.empty()) {
+        for (const auto& file : embedded::WWW_FILES) {
+            embedded_headers.push_back(
+                "Content-Type: " + content_type(std::filesystem::path(file.path).extension().string()) + "\r\n" +
+                "Content-Length: " + std::to_string(file.content.size()) + "\r\n");
+            embedded_links.push_back(
+                std::string_view(file.path).ends_with(".html") ? preload_links(file.content) : std::string());
+        }
+    }
+#endif
+
+    if (const Archive::Entry* entry = archive ? archive->find("/404.html") : nullptr) {
+        content->body = entry->body;
+    } else if (std::ifstream fallback_content("www/404.html"); fallback_content.is_open()) {
+        content->body.assign(std::istreambuf_iterator(fallback_content), std::istreambuf_iterator<char>());
+    } else {
+        content->body = R"(<html><body style="background-color: black; margin: 0; display: flex; justify-content: center; align-items: center; height: 100vh;"><div style="text-align: center;"><h1 style="font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif; color: white;">404</h1><p style="font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif; color: white;">Page Not Found</p></div><p style="position: absolute; bottom: 0; left: 50%; transform: translateX(-50%); padding: 10px; font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif; color: white;">Powered by Jella Web Server</p></body></html>)";
+    }
+
+#ifdef JELLA_EMBED_WWW
+    if (const auto* file = embedded::find_www_file("/404.html"); file && !archive) {
+        content->body = file->content;
+    }
+#endif
+
+    content->headers = "Content-Type: text/html\r\nContent-Length: " + std::to_string(content->body.size()) + "\r\n";
+    not_found_content = std::move(content);
+
+#ifndef JELLA_EMBED_WWW
+    negative_cache.clear();
+    negative_cache_order.clear();
+#endif
 }
 
-std::string webpage_handler(
-    const std::string &url
+void webpage_handler_set_archive(std::shared_ptr<const Archive> archive) {
+    current_archive.store(std::move(archive));
+    webpage_handler_init();
+}
+
+WebResponse webpage_handler(
+    const std::string &url,
+    const bool accept_gzip
 ) {
+    if (auto archive = current_archive.load()) {
+        const std::string_view path = std::string_view(url).substr(0, url.find('?'));
+        const Archive::Entry* entry = archive->find(path);
+
+        if (!entry) {
+            return not_found_response();
+        }
+
+        if (accept_gzip && !entry->gzip_headers.empty()) {
+            return {200, entry->gzip_headers, entry->gzip_body, std::move(archive), entry->links};
+        }
+
+        return {200, entry->headers, entry->body, std::move(archive), entry->links};
+    }
+
+#ifdef JELLA_EMBED_WWW
+    if (const auto* file = find_embedded_file(url)) {
+        const auto index = file - std::begin(embedded::WWW_FILES);
+        return {200, embedded_headers[index], file->content, nullptr, embedded_links[index]};
+    }
+
+    return not_found_response();
+#else
+    if (negative_cache_contains(url)) {
+        return not_found_response();
+    }
+
     std::string mutable_url = url;
     auto extension = std::filesystem::path(mutable_url).extension().string();
 
@@ -51,18 +238,32 @@ std::string webpage_handler(
         }
     }
 
-    std::ifstream content("www" + mutable_url);
+    const std::string file_path = "www" + mutable_url;
+    std::ifstream content(file_path, std::ios::binary);
 
-    if (!content.is_open()) {
-        if (std::ifstream fallback_content("www/404.html"); fallback_content.is_open()) {
-            return "HTTP/1.1 404 Not Found\r\nContent-Type: text/html\r\n\r\n" +
-                   std::string(std::istreambuf_iterator(fallback_content), std::istreambuf_iterator<char>());
-        }
+    // Directories open fine as streams but throw on the first read.
+    std::error_code error;
+    if (!content.is_open() || !std::filesystem::is_regular_file(file_path, error)) {
+        negative_cache_insert(url);
+        return not_found_response();
+    }
+
+    auto owned = std::make_shared<OwnedContent>();
 
-        return "HTTP/1.1 404 Not Found\r\nContent-Type: text/html\r\n\r\n" +
-               std::string(
-                   R"(<html><body style="background-color: black; margin: 0; display: flex; justify-content: center; align-items: center; height: 100vh;"><div style="text-align: center;"><h1 style="font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif; color: white;">404</h1><p style="font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif; color: white;">Page Not Found</p></div><p style="position: absolute; bottom: 0; left: 50%; transform: translateX(-50%); padding: 10px; font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif; color: white;">Powered by Jella Web Server</p></body></html>)");
+    // Read in one call; iterating the stream byte by byte stalls the event loop on large files.
+    const auto file_size = std::filesystem::file_size(file_path, error);
+    owned->body.resize(error ? 0 : static_cast<size_t>(file_size));
+    content.read(owned->body.data(), static_cast<std::streamsize>(owned->body.size()));
+    owned->body.resize(static_cast<size_t>(content.gcount()));
+
+    owned->headers = "Content-Type: " + content_type(extension) + "\r\n" +
+                     "Content-Length: " + std::to_string(owned->body.size()) + "\r\n";
+
+    // Files on disk are read afresh for every request, so their links are found the same way.
+    if (mutable_url.ends_with(".html")) {
+        owned->links = preload_links(owned->body);
     }
-    return "HTTP/1.1 200 OK\r\nContent-Type: " + content_type(extension) + "\r\n\r\n" +
-           std::string(std::istreambuf_iterator<char>(content), std::istreambuf_iterator<char>());
-}
\ No newline at end of file
+
+    return {200, owned->headers, owned->body, owned, owned->links};
+#endif
+}
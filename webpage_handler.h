@@ -1,7 +1,29 @@
 #ifndef WEBPAGE_HANDLER_H
 #define WEBPAGE_HANDLER_H
+#include <memory>
 #include <string>
+#include <string_view>
 
-std::string webpage_handler(const std::string &url);
+class Archive;
+
+struct WebResponse {
+    int status = 200;
+    std::string_view headers;               // "Name: value\r\n" lines, without the status line.
+    std::string_view body;
+    std::shared_ptr<const void> storage;    // Keeps the memory behind headers, body and links alive.
+    std::string_view links;                 // Preload "Link: ...\r\n" lines for an HTML page, or empty.
+};
+
+std::string content_type(const std::string &file_extension);
+
+std::string_view status_line(int status);
+
+void webpage_handler_init();
+
+// Serves from archive from now on. Archives are opened off the event loop, on the reload
+// thread, so swapping one in costs only the 404 page.
+void webpage_handler_set_archive(std::shared_ptr<const Archive> archive);
+
+WebResponse webpage_handler(const std::string &url, bool accept_gzip = false);
 
 #endif //WEBPAGE_HANDLER_H
@@ -28,18 +28,28 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
-#include <list>
+#include <deque>
+#include <iterator>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <cerrno>
+#include <climits>
 #include <cstdio>
 #include <stdarg.h>
 
-
-// Implementation access definitions.
-#define NODE_IMP static_cast<NodeImp*>(m_pImp)
-#define NODE_IMP_EXT(node) static_cast<NodeImp*>(node.m_pImp)
-#define TYPE_IMP static_cast<NodeImp*>(m_pImp)->m_pImp
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
 
 
-#define IT_IMP static_cast<IteratorImp*>(m_pImp)
+// Implementation access definitions.
+#define TYPE_IMP static_cast<TypeImp*>(m_pImp)
 
 
 namespace Yaml
@@ -58,6 +68,7 @@ namespace Yaml
     static const std::string g_ErrorIncorrectOffset         = "Incorrect offset.";
     static const std::string g_ErrorSequenceError           = "Error in sequence node.";
     static const std::string g_ErrorCannotOpenFile          = "Cannot open file.";
+    static const std::string g_ErrorCannotWriteFile         = "Cannot write file.";
     static const std::string g_ErrorIndentation             = "Space indentation is less than 2.";
     static const std::string g_ErrorInvalidBlockScalar      = "Invalid block scalar.";
     static const std::string g_ErrorInvalidQuote            = "Invalid quote.";
@@ -65,18 +76,16 @@ namespace Yaml
     static Yaml::Node        g_NoneNode;
 
     // Global function definitions. Implemented at end of this source file.
-    static std::string ExceptionMessage(const std::string & message, ReaderLine & line);
-    static std::string ExceptionMessage(const std::string & message, ReaderLine & line, const size_t errorPos);
+    static std::string ExceptionMessage(const std::string & message, const ReaderLine & line);
+    static std::string ExceptionMessage(const std::string & message, const ReaderLine & line, const size_t errorPos);
     static std::string ExceptionMessage(const std::string & message, const size_t errorLine, const size_t errorPos);
-    static std::string ExceptionMessage(const std::string & message, const size_t errorLine, const std::string & data);
-
-    static bool FindQuote(const std::string & input, size_t & start, size_t & end, size_t searchPos = 0);
-    static size_t FindNotCited(const std::string & input, char token, size_t & preQuoteCount);
-    static size_t FindNotCited(const std::string & input, char token);
-    static bool ValidateQuote(const std::string & input);
-    static void CopyNode(const Node & from, Node & to);
-    static bool ShouldBeCited(const std::string & key);
-    static void AddEscapeTokens(std::string & input, const std::string & tokens);
+    static std::string ExceptionMessage(const std::string & message, const size_t errorLine, const std::string_view data);
+
+    static bool FindQuote(const std::string_view input, size_t & start, size_t & end, size_t searchPos = 0);
+    static size_t FindNotCited(const std::string_view input, char token, size_t & preQuoteCount);
+    static size_t FindNotCited(const std::string_view input, char token);
+    static bool ValidateQuote(const std::string_view input);
+    static bool ShouldBeCited(const std::string_view key);
     static void RemoveAllEscapeTokens(std::string & input);
 
     // Exception implementations
@@ -124,244 +133,304 @@ namespace Yaml
         {
         }
 
-        virtual const std::string & GetData() const = 0;
-        virtual bool SetData(const std::string & data) = 0;
+        virtual Node::eType GetType() const = 0;
+        virtual std::string_view GetData() const = 0;
+        virtual bool SetData(const std::string_view data) = 0;
         virtual size_t GetSize() const = 0;
         virtual Node * GetNode(const size_t index) = 0;
-        virtual Node * GetNode(const std::string & key) = 0;
+        virtual Node * GetNode(const std::string_view key) = 0;
         virtual Node * Insert(const size_t index) = 0;
         virtual Node * PushFront() = 0;
         virtual Node * PushBack() = 0;
         virtual void Erase(const size_t index) = 0;
-        virtual void Erase(const std::string & key) = 0;
+        virtual void Erase(const std::string_view key) = 0;
 
     };
 
-    class SequenceImp : public TypeImp
+    class MapImp;
+
+    /**
+    * @breif Implementation of arena class.
+    *
+    */
+    class ArenaImp
     {
 
     public:
 
-        ~SequenceImp()
+        explicit ArenaImp(const size_t blockSize) :
+            Resource(blockSize)
         {
-            for(auto it = m_Sequence.begin(); it != m_Sequence.end(); it++)
-            {
-                delete it->second;
-            }
         }
 
-        virtual const std::string & GetData() const
-        {
-            return g_EmptyString;
-        }
+        std::pmr::monotonic_buffer_resource Resource;       ///< Bump allocator for all document data.
+        MapImp *                            pMaps = nullptr; ///< Maps to destroy with the arena; long keys own heap memory.
 
-        virtual bool SetData(const std::string & data)
-        {
-            return false;
-        }
+    };
 
-        virtual size_t GetSize() const
+    /**
+    * @breif Access to arena internals for the implementation classes.
+    *
+    */
+    struct ArenaAccess
+    {
+        static ArenaImp & Imp(Arena & arena)
         {
-            return m_Sequence.size();
+            return *static_cast<ArenaImp*>(arena.m_pImp);
         }
+    };
 
-        virtual Node * GetNode(const size_t index)
-        {
-            auto it = m_Sequence.find(index);
-            if(it != m_Sequence.end())
-            {
-                return it->second;
-            }
-            return nullptr;
-        }
+    /**
+    * @breif Pool of sequence and map item nodes, shared by all documents.
+    *        Nodes are carved out of chunks and recycled through a free list,
+    *        so building a large document does not cost one allocation per item.
+    *
+    */
+    class NodePool
+    {
+
+    public:
 
-        virtual Node * GetNode(const std::string & key)
+        static NodePool & Instance()
         {
-            return nullptr;
+            // Never destroyed, so static nodes may outlive it at exit.
+            static NodePool * pPool = new NodePool;
+            return *pPool;
         }
 
-        virtual Node * Insert(const size_t index)
+        Node * Acquire()
         {
-            if(m_Sequence.size() == 0)
-            {
-                Node * pNode = new Node;
-                m_Sequence.insert({0, pNode});
-                return pNode;
-            }
-
-            if(index >= m_Sequence.size())
-            {
-                auto it = m_Sequence.end();
-                --it;
-                Node * pNode = new Node;
-                m_Sequence.insert({it->first, pNode});
-                return pNode;
-            }
-
-            auto it = m_Sequence.cbegin();
-            while(it != m_Sequence.cend())
+            void * pStorage = nullptr;
             {
-                m_Sequence[it->first+1] = it->second;
-
-                if(it->first == index)
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                if(m_pFree == nullptr)
                 {
-                    break;
+                    Grow();
                 }
+                Slot * pSlot = m_pFree;
+                m_pFree = pSlot->pNext;
+                pStorage = pSlot->Storage;
             }
-
-            Node * pNode = new Node;
-            m_Sequence.insert({index, pNode});
-            return pNode;
+            return new (pStorage) Node;
         }
 
-        virtual Node * PushFront()
+        void Release(Node * pNode)
         {
-            for(auto it = m_Sequence.cbegin(); it != m_Sequence.cend(); it++)
-            {
-                m_Sequence[it->first+1] = it->second;
-            }
+            pNode->~Node();
 
-            Node * pNode = new Node;
-            m_Sequence.insert({0, pNode});
-            return pNode;
+            Slot * pSlot = reinterpret_cast<Slot*>(pNode);
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            pSlot->pNext = m_pFree;
+            m_pFree = pSlot;
         }
 
-        virtual Node * PushBack()
+    private:
+
+        union Slot
         {
-            size_t index = 0;
-            if(m_Sequence.size())
-            {
-                auto it = m_Sequence.end();
-                --it;
-                index = it->first + 1;
-            }
+            Slot * pNext;
+            alignas(Node) unsigned char Storage[sizeof(Node)];
+        };
 
-            Node * pNode = new Node;
-            m_Sequence.insert({index, pNode});
-            return pNode;
-        }
+        static const size_t ChunkSize = 256;
 
-        virtual void Erase(const size_t index)
+        void Grow()
         {
-            auto it = m_Sequence.find(index);
-            if(it == m_Sequence.end())
+            m_Chunks.emplace_back(new Slot[ChunkSize]);
+            Slot * pChunk = m_Chunks.back().get();
+            for(size_t i = 0; i < ChunkSize; i++)
             {
-                return;
+                pChunk[i].pNext = m_pFree;
+                m_pFree = &pChunk[i];
             }
-            delete it->second;
-            m_Sequence.erase(index);
         }
 
-        virtual void Erase(const std::string & key)
+        std::mutex                          m_Mutex;
+        std::vector<std::unique_ptr<Slot[]>> m_Chunks;
+        Slot *                              m_pFree = nullptr;
+
+    };
+
+    /**
+    * @breif Create an item node, from the arena if given, else from the pool.
+    *
+    */
+    static Node * CreateNode(Arena * pArena)
+    {
+        if(pArena == nullptr)
         {
+            return NodePool::Instance().Acquire();
         }
+        return new (ArenaAccess::Imp(*pArena).Resource.allocate(sizeof(Node), alignof(Node))) Node(*pArena);
+    }
 
-        std::map<size_t, Node*> m_Sequence;
+    /**
+    * @breif Destroy an item node. Arena nodes are reclaimed with their arena.
+    *
+    */
+    static void DestroyNode(Node * pNode, Arena * pArena)
+    {
+        if(pArena == nullptr)
+        {
+            NodePool::Instance().Release(pNode);
+        }
+    }
 
-    };
+    static std::pmr::memory_resource * MemoryResource(Arena * pArena)
+    {
+        return pArena ? &ArenaAccess::Imp(*pArena).Resource : std::pmr::new_delete_resource();
+    }
 
-    class MapImp : public TypeImp
+    class SequenceImp : public TypeImp
     {
 
     public:
 
-        ~MapImp()
+        SequenceImp(Arena * pArena) :
+            m_Sequence(MemoryResource(pArena)),
+            m_pArena(pArena)
         {
-            for(auto it = m_Map.begin(); it != m_Map.end(); it++)
+        }
+
+        ~SequenceImp()
+        {
+            for(auto it = m_Sequence.begin(); it != m_Sequence.end(); it++)
             {
-                delete it->second;
+                DestroyNode(*it, m_pArena);
             }
         }
 
-        virtual const std::string & GetData() const
+        virtual Node::eType GetType() const
+        {
+            return Node::SequenceType;
+        }
+
+        virtual std::string_view GetData() const
         {
-            return g_EmptyString;
+            return std::string_view();
         }
 
-        virtual bool SetData(const std::string & data)
+        virtual bool SetData(const std::string_view data)
         {
             return false;
         }
 
         virtual size_t GetSize() const
         {
-            return m_Map.size();
+            return m_Sequence.size();
         }
 
         virtual Node * GetNode(const size_t index)
         {
+            if(index < m_Sequence.size())
+            {
+                return m_Sequence[index];
+            }
             return nullptr;
         }
 
-        virtual Node * GetNode(const std::string & key)
+        virtual Node * GetNode(const std::string_view key)
         {
-            auto it = m_Map.find(key);
-            if(it == m_Map.end())
-            {
-                Node * pNode = new Node;
-                m_Map.insert({key, pNode});
-                return pNode;
-            }
-            return it->second;
+            return nullptr;
         }
 
         virtual Node * Insert(const size_t index)
         {
-            return nullptr;
+            Node * pNode = CreateNode(m_pArena);
+            m_Sequence.insert(m_Sequence.begin() + std::min(index, m_Sequence.size()), pNode);
+            return pNode;
         }
 
         virtual Node * PushFront()
         {
-            return nullptr;
+            Node * pNode = CreateNode(m_pArena);
+            m_Sequence.insert(m_Sequence.begin(), pNode);
+            return pNode;
         }
 
         virtual Node * PushBack()
         {
-            return nullptr;
+            Node * pNode = CreateNode(m_pArena);
+            m_Sequence.push_back(pNode);
+            return pNode;
         }
 
         virtual void Erase(const size_t index)
         {
-        }
-
-        virtual void Erase(const std::string & key)
-        {
-            auto it = m_Map.find(key);
-            if(it == m_Map.end())
+            if(index >= m_Sequence.size())
             {
                 return;
             }
-            delete it->second;
-            m_Map.erase(key);
+            DestroyNode(m_Sequence[index], m_pArena);
+            m_Sequence.erase(m_Sequence.begin() + index);
+        }
+
+        virtual void Erase(const std::string_view key)
+        {
         }
 
-        std::map<std::string, Node*> m_Map;
+        std::pmr::vector<Node*> m_Sequence;
+        Arena *                 m_pArena;
 
     };
 
-    class ScalarImp : public TypeImp
+    /**
+    * @breif Map storage: entries in insertion order, indexed by an open-addressing
+    *        hash table with linear probing. Lookups take a string_view, so finding
+    *        an existing key never constructs a string.
+    *
+    */
+    class MapImp : public TypeImp
     {
 
     public:
 
-        ~ScalarImp()
+        struct Entry
+        {
+            std::string Key;
+            Node *      pNode;
+            size_t      Hash;
+        };
+
+        MapImp(Arena * pArena) :
+            m_Map(MemoryResource(pArena)),
+            m_pArena(pArena),
+            m_Index(MemoryResource(pArena))
+        {
+            if(pArena)
+            {
+                ArenaImp & arena = ArenaAccess::Imp(*pArena);
+                m_pNextInArena = arena.pMaps;
+                arena.pMaps = this;
+            }
+        }
+
+        ~MapImp()
+        {
+            for(auto it = m_Map.begin(); it != m_Map.end(); it++)
+            {
+                DestroyNode(it->pNode, m_pArena);
+            }
+        }
+
+        virtual Node::eType GetType() const
         {
+            return Node::MapType;
         }
 
-        virtual const std::string & GetData() const
+        virtual std::string_view GetData() const
         {
-            return m_Value;
+            return std::string_view();
         }
 
-        virtual bool SetData(const std::string & data)
+        virtual bool SetData(const std::string_view data)
         {
-            m_Value = data;
-            return true;
+            return false;
         }
 
         virtual size_t GetSize() const
         {
-            return 0;
+            return m_Map.size();
         }
 
         virtual Node * GetNode(const size_t index)
@@ -369,9 +438,29 @@ namespace Yaml
             return nullptr;
         }
 
-        virtual Node * GetNode(const std::string & key)
+        virtual Node * GetNode(const std::string_view key)
         {
-            return nullptr;
+            const size_t hash = std::hash<std::string_view>()(key);
+            size_t slot = 0;
+            const size_t entry = Find(key, hash, slot);
+            if(entry != NoEntry)
+            {
+                return m_Map[entry].pNode;
+            }
+
+            Node * pNode = CreateNode(m_pArena);
+            m_Map.push_back({std::string(key), pNode, hash});
+
+            // Keep the table at most half full.
+            if(m_Map.size() * 2 > m_Index.size())
+            {
+                Rehash(std::max<size_t>(m_Index.size() * 2, 8));
+            }
+            else
+            {
+                m_Index[slot] = m_Map.size();
+            }
+            return pNode;
         }
 
         virtual Node * Insert(const size_t index)
@@ -393,325 +482,233 @@ namespace Yaml
         {
         }
 
-        virtual void Erase(const std::string & key)
+        virtual void Erase(const std::string_view key)
         {
-        }
-
-        std::string m_Value;
-
-    };
-
-
-    // Node implementations.
-    class NodeImp
-    {
-
-    public:
+            size_t slot = 0;
+            const size_t entry = Find(key, std::hash<std::string_view>()(key), slot);
+            if(entry == NoEntry)
+            {
+                return;
+            }
+            DestroyNode(m_Map[entry].pNode, m_pArena);
+            m_Map.erase(m_Map.begin() + entry);
 
-        NodeImp() :
-            m_Type(Node::None),
-            m_pImp(nullptr)
-        {
+            // Later entries moved down by one; erasing is rare, so rebuild the index.
+            Rehash(m_Index.size());
         }
 
-        ~NodeImp()
-        {
-            Clear();
-        }
+        std::pmr::vector<Entry> m_Map;                  ///< Entries in insertion order.
+        Arena *                 m_pArena;
+        MapImp *                m_pNextInArena = nullptr;
 
-        void Clear()
-        {
-            if(m_pImp != nullptr)
-            {
-                delete m_pImp;
-                m_pImp = nullptr;
-            }
-            m_Type = Node::None;
-        }
+    private:
+
+        static const size_t NoEntry = static_cast<size_t>(-1);
 
-        void InitSequence()
+        /**
+        * @breif Finds key, returning its entry index or NoEntry.
+        *        slot receives the index slot holding it, or the free slot it would take.
+        *
+        */
+        size_t Find(const std::string_view key, const size_t hash, size_t & slot) const
         {
-            if(m_Type != Node::SequenceType || m_pImp == nullptr)
+            if(m_Index.empty())
             {
-                if(m_pImp)
-                {
-                    delete m_pImp;
-                }
-                m_pImp = new SequenceImp;
-                m_Type = Node::SequenceType;
+                return NoEntry;
             }
-        }
 
-        void InitMap()
-        {
-            if(m_Type != Node::MapType || m_pImp == nullptr)
+            const size_t mask = m_Index.size() - 1;
+            for(slot = hash & mask; m_Index[slot] != 0; slot = (slot + 1) & mask)
             {
-                if(m_pImp)
+                const Entry & entry = m_Map[m_Index[slot] - 1];
+                if(entry.Hash == hash && entry.Key == key)
                 {
-                    delete m_pImp;
+                    return m_Index[slot] - 1;
                 }
-                m_pImp = new MapImp;
-                m_Type = Node::MapType;
             }
+            return NoEntry;
         }
 
-        void InitScalar()
+        void Rehash(const size_t capacity)
         {
-            if(m_Type != Node::ScalarType || m_pImp == nullptr)
+            m_Index.assign(capacity, 0);
+            const size_t mask = capacity - 1;
+            for(size_t i = 0; i < m_Map.size(); i++)
             {
-                if(m_pImp)
+                size_t slot = m_Map[i].Hash & mask;
+                while(m_Index[slot] != 0)
                 {
-                    delete m_pImp;
+                    slot = (slot + 1) & mask;
                 }
-                m_pImp = new ScalarImp;
-                m_Type = Node::ScalarType;
+                m_Index[slot] = i + 1;
             }
-
         }
 
-        Node::eType    m_Type;  ///< Type of node.
-        TypeImp *      m_pImp;  ///< Imp of type.
+        std::pmr::vector<size_t> m_Index;   ///< Entry index + 1 per slot, 0 if free. Power of two size.
 
     };
 
-    // Iterator implementation class
-    class IteratorImp
+    class ScalarImp : public TypeImp
     {
 
     public:
 
-        virtual ~IteratorImp()
+        ScalarImp(Arena * pArena) :
+            m_Value(MemoryResource(pArena))
         {
         }
 
-        virtual Node::eType GetType() const = 0;
-        virtual void InitBegin(SequenceImp * pSequenceImp) = 0;
-        virtual void InitEnd(SequenceImp * pSequenceImp) = 0;
-        virtual void InitBegin(MapImp * pMapImp) = 0;
-        virtual void InitEnd(MapImp * pMapImp) = 0;
-
-    };
-
-    class SequenceIteratorImp : public IteratorImp
-    {
-
-    public:
-
-        virtual Node::eType GetType() const
+        ~ScalarImp()
         {
-            return Node::SequenceType;
         }
 
-        virtual void InitBegin(SequenceImp * pSequenceImp)
+        virtual Node::eType GetType() const
         {
-            m_Iterator = pSequenceImp->m_Sequence.begin();
+            return Node::ScalarType;
         }
 
-        virtual void InitEnd(SequenceImp * pSequenceImp)
+        virtual std::string_view GetData() const
         {
-            m_Iterator = pSequenceImp->m_Sequence.end();
+            return m_Value;
         }
 
-        virtual void InitBegin(MapImp * pMapImp)
+        virtual bool SetData(const std::string_view data)
         {
+            m_Value.assign(data.data(), data.size());
+            m_Cache.Kind = impl::CacheKind::None;
+            return true;
         }
 
-        virtual void InitEnd(MapImp * pMapImp)
+        virtual size_t GetSize() const
         {
+            return 0;
         }
 
-        void Copy(const SequenceIteratorImp & it)
+        virtual Node * GetNode(const size_t index)
         {
-            m_Iterator = it.m_Iterator;
+            return nullptr;
         }
 
-        std::map<size_t, Node *>::iterator m_Iterator;
-
-    };
-
-    class MapIteratorImp : public IteratorImp
-    {
-
-    public:
-
-        virtual Node::eType GetType() const
+        virtual Node * GetNode(const std::string_view key)
         {
-            return Node::MapType;
+            return nullptr;
         }
 
-        virtual void InitBegin(SequenceImp * pSequenceImp)
+        virtual Node * Insert(const size_t index)
         {
+            return nullptr;
         }
 
-        virtual void InitEnd(SequenceImp * pSequenceImp)
+        virtual Node * PushFront()
         {
+            return nullptr;
         }
 
-        virtual void InitBegin(MapImp * pMapImp)
+        virtual Node * PushBack()
         {
-            m_Iterator = pMapImp->m_Map.begin();
+            return nullptr;
         }
 
-        virtual void InitEnd(MapImp * pMapImp)
+        virtual void Erase(const size_t index)
         {
-            m_Iterator = pMapImp->m_Map.end();
         }
 
-        void Copy(const MapIteratorImp & it)
+        virtual void Erase(const std::string_view key)
         {
-            m_Iterator = it.m_Iterator;
         }
 
-        std::map<std::string, Node *>::iterator m_Iterator;
+        std::pmr::string            m_Value;
+        mutable impl::CachedValue   m_Cache;    ///< Last number or bool conversion of value.
 
     };
 
-    class SequenceConstIteratorImp : public IteratorImp
-    {
-
-    public:
-
-        virtual Node::eType GetType() const
-        {
-            return Node::SequenceType;
-        }
 
-        virtual void InitBegin(SequenceImp * pSequenceImp)
+    /**
+    * @breif Release type implementation. Arena memory is reclaimed with the arena.
+    *
+    */
+    static void DestroyImp(TypeImp * pImp, Arena * pArena)
+    {
+        if(pArena == nullptr)
         {
-            m_Iterator = pSequenceImp->m_Sequence.begin();
+            delete pImp;
         }
+    }
 
-        virtual void InitEnd(SequenceImp * pSequenceImp)
+    /**
+    * @breif Make the node's implementation of type T, replacing any other type.
+    *
+    */
+    template<typename T>
+    static T * InitImp(void *& pImp, Arena * pArena, const Node::eType type)
+    {
+        TypeImp * pCurrent = static_cast<TypeImp*>(pImp);
+        if(pCurrent != nullptr && pCurrent->GetType() == type)
         {
-            m_Iterator = pSequenceImp->m_Sequence.end();
+            return static_cast<T*>(pCurrent);
         }
 
-        virtual void InitBegin(MapImp * pMapImp)
-        {
-        }
+        DestroyImp(pCurrent, pArena);
+        pImp = nullptr;
 
-        virtual void InitEnd(MapImp * pMapImp)
+        T * pNew = nullptr;
+        if(pArena == nullptr)
         {
+            pNew = new T(nullptr);
         }
-
-        void Copy(const SequenceConstIteratorImp & it)
+        else
         {
-            m_Iterator = it.m_Iterator;
+            pNew = new (ArenaAccess::Imp(*pArena).Resource.allocate(sizeof(T), alignof(T))) T(pArena);
         }
+        pImp = static_cast<TypeImp*>(pNew);
+        return pNew;
+    }
 
-        std::map<size_t, Node *>::const_iterator m_Iterator;
-
-    };
 
-    class MapConstIteratorImp : public IteratorImp
+    // Arena class
+    Arena::Arena(const size_t blockSize) :
+        m_pImp(new ArenaImp(blockSize))
     {
+    }
 
-    public:
-
-        virtual Node::eType GetType() const
+    Arena::~Arena()
+    {
+        // Nothing else in the arena owns memory outside of it.
+        ArenaImp * pImp = static_cast<ArenaImp*>(m_pImp);
+        for(MapImp * pMap = pImp->pMaps; pMap != nullptr;)
         {
-            return Node::MapType;
+            MapImp * pNext = pMap->m_pNextInArena;
+            pMap->~MapImp();
+            pMap = pNext;
         }
-
-        virtual void InitBegin(SequenceImp * pSequenceImp)
-        {
-        }
-
-        virtual void InitEnd(SequenceImp * pSequenceImp)
-        {
-        }
-
-        virtual void InitBegin(MapImp * pMapImp)
-        {
-            m_Iterator = pMapImp->m_Map.begin();
-        }
-
-        virtual void InitEnd(MapImp * pMapImp)
-        {
-            m_Iterator = pMapImp->m_Map.end();
-        }
-
-        void Copy(const MapConstIteratorImp & it)
-        {
-            m_Iterator = it.m_Iterator;
-        }
-
-        std::map<std::string, Node *>::const_iterator m_Iterator;
-
-    };
+        delete pImp;
+    }
 
 
     // Iterator class
     Iterator::Iterator() :
         m_Type(None),
-        m_pImp(nullptr)
+        m_pImp(nullptr),
+        m_Index(0)
     {
     }
 
     Iterator::~Iterator()
     {
-        if(m_pImp)
-        {
-            switch(m_Type)
-            {
-            case SequenceType:
-                delete static_cast<SequenceIteratorImp*>(m_pImp);
-                break;
-            case MapType:
-                delete static_cast<MapIteratorImp*>(m_pImp);
-                break;
-            default:
-                break;
-            }
-
-        }
     }
 
     Iterator::Iterator(const Iterator & it) :
-        m_Type(None),
-        m_pImp(nullptr)
+        m_Type(it.m_Type),
+        m_pImp(it.m_pImp),
+        m_Index(it.m_Index)
     {
-        *this = it;
     }
 
     Iterator & Iterator::operator = (const Iterator & it)
     {
-        if(m_pImp)
-        {
-            switch(m_Type)
-            {
-            case SequenceType:
-                delete static_cast<SequenceIteratorImp*>(m_pImp);
-                break;
-            case MapType:
-                delete static_cast<MapIteratorImp*>(m_pImp);
-                break;
-            default:
-                break;
-            }
-            m_pImp = nullptr;
-            m_Type = None;
-        }
-
-        IteratorImp * pNewImp = nullptr;
-
-        switch(it.m_Type)
-        {
-        case SequenceType:
-            m_Type = SequenceType;
-            pNewImp = new SequenceIteratorImp;
-            static_cast<SequenceIteratorImp*>(pNewImp)->m_Iterator = static_cast<SequenceIteratorImp*>(it.m_pImp)->m_Iterator;
-            break;
-        case MapType:
-            m_Type = MapType;
-            pNewImp = new MapIteratorImp;
-            static_cast<MapIteratorImp*>(pNewImp)->m_Iterator = static_cast<MapIteratorImp*>(it.m_pImp)->m_Iterator;
-            break;
-        default:
-            break;
-        }
-
-        m_pImp = pNewImp;
+        m_Type = it.m_Type;
+        m_pImp = it.m_pImp;
+        m_Index = it.m_Index;
         return *this;
     }
 
@@ -720,11 +717,13 @@ namespace Yaml
         switch(m_Type)
         {
         case SequenceType:
-            return { g_EmptyString, *(static_cast<SequenceIteratorImp*>(m_pImp)->m_Iterator->second)};
+            return { g_EmptyString, *static_cast<SequenceImp*>(m_pImp)->m_Sequence[m_Index]};
             break;
         case MapType:
-            return {static_cast<MapIteratorImp*>(m_pImp)->m_Iterator->first,
-                    *(static_cast<MapIteratorImp*>(m_pImp)->m_Iterator->second)};
+        {
+            const MapImp::Entry & entry = static_cast<MapImp*>(m_pImp)->m_Map[m_Index];
+            return {entry.Key, *entry.pNode};
+        }
             break;
         default:
             break;
@@ -736,56 +735,19 @@ namespace Yaml
 
     Iterator & Iterator::operator ++ (int dummy)
     {
-        switch(m_Type)
-        {
-        case SequenceType:
-            static_cast<SequenceIteratorImp*>(m_pImp)->m_Iterator++;
-            break;
-        case MapType:
-            static_cast<MapIteratorImp*>(m_pImp)->m_Iterator++;
-            break;
-        default:
-            break;
-        }
+        m_Index++;
         return *this;
     }
 
     Iterator & Iterator::operator -- (int dummy)
     {
-        switch(m_Type)
-        {
-        case SequenceType:
-            static_cast<SequenceIteratorImp*>(m_pImp)->m_Iterator--;
-            break;
-        case MapType:
-            static_cast<MapIteratorImp*>(m_pImp)->m_Iterator--;
-            break;
-        default:
-            break;
-        }
+        m_Index--;
         return *this;
     }
 
     bool Iterator::operator == (const Iterator & it)
     {
-        if(m_Type != it.m_Type)
-        {
-            return false;
-        }
-
-        switch(m_Type)
-        {
-        case SequenceType:
-            return static_cast<SequenceIteratorImp*>(m_pImp)->m_Iterator == static_cast<SequenceIteratorImp*>(it.m_pImp)->m_Iterator;
-            break;
-        case MapType:
-            return static_cast<MapIteratorImp*>(m_pImp)->m_Iterator == static_cast<MapIteratorImp*>(it.m_pImp)->m_Iterator;
-            break;
-        default:
-            break;
-        }
-
-        return false;
+        return m_Type == it.m_Type && m_pImp == it.m_pImp && m_Index == it.m_Index;
     }
 
     bool Iterator::operator != (const Iterator & it)
@@ -797,74 +759,27 @@ namespace Yaml
     // Const Iterator class
     ConstIterator::ConstIterator() :
         m_Type(None),
-        m_pImp(nullptr)
+        m_pImp(nullptr),
+        m_Index(0)
     {
     }
 
     ConstIterator::~ConstIterator()
     {
-        if(m_pImp)
-        {
-            switch(m_Type)
-            {
-            case SequenceType:
-                delete static_cast<SequenceConstIteratorImp*>(m_pImp);
-                break;
-            case MapType:
-                delete static_cast<MapConstIteratorImp*>(m_pImp);
-                break;
-            default:
-                break;
-            }
-
-        }
     }
 
     ConstIterator::ConstIterator(const ConstIterator & it) :
-        m_Type(None),
-        m_pImp(nullptr)
+        m_Type(it.m_Type),
+        m_pImp(it.m_pImp),
+        m_Index(it.m_Index)
     {
-        *this = it;
     }
 
     ConstIterator & ConstIterator::operator = (const ConstIterator & it)
     {
-        if(m_pImp)
-        {
-            switch(m_Type)
-            {
-            case SequenceType:
-                delete static_cast<SequenceConstIteratorImp*>(m_pImp);
-                break;
-            case MapType:
-                delete static_cast<MapConstIteratorImp*>(m_pImp);
-                break;
-            default:
-                break;
-            }
-            m_pImp = nullptr;
-            m_Type = None;
-        }
-
-        IteratorImp * pNewImp = nullptr;
-
-        switch(it.m_Type)
-        {
-        case SequenceType:
-            m_Type = SequenceType;
-            pNewImp = new SequenceConstIteratorImp;
-            static_cast<SequenceConstIteratorImp*>(pNewImp)->m_Iterator = static_cast<SequenceConstIteratorImp*>(it.m_pImp)->m_Iterator;
-            break;
-        case MapType:
-            m_Type = MapType;
-            pNewImp = new MapConstIteratorImp;
-            static_cast<MapConstIteratorImp*>(pNewImp)->m_Iterator = static_cast<MapConstIteratorImp*>(it.m_pImp)->m_Iterator;
-            break;
-        default:
-            break;
-        }
-
-        m_pImp = pNewImp;
+        m_Type = it.m_Type;
+        m_pImp = it.m_pImp;
+        m_Index = it.m_Index;
         return *this;
     }
 
@@ -873,11 +788,13 @@ namespace Yaml
         switch(m_Type)
         {
         case SequenceType:
-            return { g_EmptyString, *(static_cast<SequenceConstIteratorImp*>(m_pImp)->m_Iterator->second)};
+            return { g_EmptyString, *static_cast<const SequenceImp*>(m_pImp)->m_Sequence[m_Index]};
             break;
         case MapType:
-            return {static_cast<MapConstIteratorImp*>(m_pImp)->m_Iterator->first,
-                    *(static_cast<MapConstIteratorImp*>(m_pImp)->m_Iterator->second)};
+        {
+            const MapImp::Entry & entry = static_cast<const MapImp*>(m_pImp)->m_Map[m_Index];
+            return {entry.Key, *entry.pNode};
+        }
             break;
         default:
             break;
@@ -889,56 +806,19 @@ namespace Yaml
 
     ConstIterator & ConstIterator::operator ++ (int dummy)
     {
-        switch(m_Type)
-        {
-        case SequenceType:
-            static_cast<SequenceConstIteratorImp*>(m_pImp)->m_Iterator++;
-            break;
-        case MapType:
-            static_cast<MapConstIteratorImp*>(m_pImp)->m_Iterator++;
-            break;
-        default:
-            break;
-        }
+        m_Index++;
         return *this;
     }
 
     ConstIterator & ConstIterator::operator -- (int dummy)
     {
-        switch(m_Type)
-        {
-        case SequenceType:
-            static_cast<SequenceConstIteratorImp*>(m_pImp)->m_Iterator--;
-            break;
-        case MapType:
-            static_cast<MapConstIteratorImp*>(m_pImp)->m_Iterator--;
-            break;
-        default:
-            break;
-        }
+        m_Index--;
         return *this;
     }
 
     bool ConstIterator::operator == (const ConstIterator & it)
     {
-        if(m_Type != it.m_Type)
-        {
-            return false;
-        }
-
-        switch(m_Type)
-        {
-        case SequenceType:
-            return static_cast<SequenceConstIteratorImp*>(m_pImp)->m_Iterator == static_cast<SequenceConstIteratorImp*>(it.m_pImp)->m_Iterator;
-            break;
-        case MapType:
-            return static_cast<MapConstIteratorImp*>(m_pImp)->m_Iterator == static_cast<MapConstIteratorImp*>(it.m_pImp)->m_Iterator;
-            break;
-        default:
-            break;
-        }
-
-        return false;
+        return m_Type == it.m_Type && m_pImp == it.m_pImp && m_Index == it.m_Index;
     }
 
     bool ConstIterator::operator != (const ConstIterator & it)
@@ -949,7 +829,16 @@ namespace Yaml
 
     // Node class
     Node::Node() :
-        m_pImp(new NodeImp)
+        m_pImp(nullptr),
+        m_pArena(nullptr),
+        m_Line(0)
+    {
+    }
+
+    Node::Node(Arena & arena) :
+        m_pImp(nullptr),
+        m_pArena(&arena),
+        m_Line(0)
     {
     }
 
@@ -959,6 +848,14 @@ namespace Yaml
         *this = node;
     }
 
+    Node::Node(Node && node) noexcept :
+        m_pImp(node.m_pImp),
+        m_pArena(node.m_pArena),
+        m_Line(node.m_Line)
+    {
+        node.m_pImp = nullptr;
+    }
+
     Node::Node(const std::string & value) :
         Node()
     {
@@ -973,37 +870,39 @@ namespace Yaml
 
     Node::~Node()
     {
-        delete static_cast<NodeImp*>(m_pImp);
+        Clear();
     }
 
     Node::eType Node::Type() const
     {
-        return NODE_IMP->m_Type;
+        return TYPE_IMP ? TYPE_IMP->GetType() : Node::None;
     }
 
     bool Node::IsNone() const
     {
-        return NODE_IMP->m_Type == Node::None;
+        return Type() == Node::None;
     }
 
     bool Node::IsSequence() const
     {
-        return NODE_IMP->m_Type == Node::SequenceType;
+        return Type() == Node::SequenceType;
     }
 
     bool Node::IsMap() const
     {
-        return NODE_IMP->m_Type == Node::MapType;
+        return Type() == Node::MapType;
     }
 
     bool Node::IsScalar() const
     {
-        return NODE_IMP->m_Type == Node::ScalarType;
+        return Type() == Node::ScalarType;
     }
 
     void Node::Clear()
     {
-        NODE_IMP->Clear();
+        DestroyImp(TYPE_IMP, m_pArena);
+        m_pImp = nullptr;
+        m_Line = 0;
     }
 
     size_t Node::Size() const
@@ -1016,27 +915,28 @@ namespace Yaml
         return TYPE_IMP->GetSize();
     }
 
+    size_t Node::Line() const
+    {
+        return m_Line;
+    }
+
     Node & Node::Insert(const size_t index)
     {
-        NODE_IMP->InitSequence();
-        return *TYPE_IMP->Insert(index);
+        return *InitImp<SequenceImp>(m_pImp, m_pArena, SequenceType)->Insert(index);
     }
 
     Node & Node::PushFront()
     {
-        NODE_IMP->InitSequence();
-        return *TYPE_IMP->PushFront();
+        return *InitImp<SequenceImp>(m_pImp, m_pArena, SequenceType)->PushFront();
     }
     Node & Node::PushBack()
     {
-        NODE_IMP->InitSequence();
-        return *TYPE_IMP->PushBack();
+        return *InitImp<SequenceImp>(m_pImp, m_pArena, SequenceType)->PushBack();
     }
 
     Node & Node::operator[](const size_t index)
     {
-        NODE_IMP->InitSequence();
-        Node * pNode = TYPE_IMP->GetNode(index);
+        Node * pNode = InitImp<SequenceImp>(m_pImp, m_pArena, SequenceType)->GetNode(index);
         if(pNode == nullptr)
         {
             g_NoneNode.Clear();
@@ -1045,15 +945,14 @@ namespace Yaml
         return *pNode;
     }
 
-    Node & Node::operator[](const std::string & key)
+    Node & Node::operator[](const std::string_view key)
     {
-        NODE_IMP->InitMap();
-        return *TYPE_IMP->GetNode(key);
+        return *InitImp<MapImp>(m_pImp, m_pArena, MapType)->GetNode(key);
     }
 
     void Node::Erase(const size_t index)
     {
-        if(TYPE_IMP == nullptr || NODE_IMP->m_Type != Node::SequenceType)
+        if(TYPE_IMP == nullptr || Type() != Node::SequenceType)
         {
             return;
         }
@@ -1061,9 +960,9 @@ namespace Yaml
         return TYPE_IMP->Erase(index);
     }
 
-    void Node::Erase(const std::string & key)
+    void Node::Erase(const std::string_view key)
     {
-        if(TYPE_IMP == nullptr || NODE_IMP->m_Type != Node::MapType)
+        if(TYPE_IMP == nullptr || Type() != Node::MapType)
         {
             return;
         }
@@ -1073,50 +972,70 @@ namespace Yaml
 
     Node & Node::operator = (const Node & node)
     {
-        NODE_IMP->Clear();
-        CopyNode(node, *this);
+        if(this != &node)
+        {
+            // Copy first, node may be a child of this one.
+            Node copy = m_pArena ? Node(*m_pArena) : Node();
+            copy.CopyFrom(node);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    Node & Node::operator = (Node && node) noexcept
+    {
+        if(this == &node)
+        {
+            return *this;
+        }
+
+        // Data cannot move between arenas, copy it instead.
+        if(m_pArena != node.m_pArena)
+        {
+            return *this = static_cast<const Node &>(node);
+        }
+
+        // Detach before releasing the old data, node may be a child of this one.
+        TypeImp * pOld = TYPE_IMP;
+        m_pImp = node.m_pImp;
+        m_Line = node.m_Line;
+        node.m_pImp = nullptr;
+        DestroyImp(pOld, m_pArena);
         return *this;
     }
 
     Node & Node::operator = (const std::string & value)
     {
-        NODE_IMP->InitScalar();
-        TYPE_IMP->SetData(value);
+        return *this = std::string_view(value);
+    }
+
+    Node & Node::operator = (const std::string_view value)
+    {
+        InitImp<ScalarImp>(m_pImp, m_pArena, ScalarType)->SetData(value);
         return *this;
     }
 
     Node & Node::operator = (const char * value)
     {
-        NODE_IMP->InitScalar();
-        TYPE_IMP->SetData(value ? std::string(value) : "");
-        return *this;
+        return *this = std::string_view(value ? value : "");
     }
 
     Iterator Node::Begin()
     {
         Iterator it;
 
-        if(TYPE_IMP != nullptr)
+        switch(Type())
         {
-            IteratorImp * pItImp = nullptr;
-
-            switch(NODE_IMP->m_Type)
-            {
-            case Node::SequenceType:
-                it.m_Type = Iterator::SequenceType;
-                pItImp = new SequenceIteratorImp;
-                pItImp->InitBegin(static_cast<SequenceImp*>(TYPE_IMP));
-                break;
-            case Node::MapType:
-                it.m_Type = Iterator::MapType;
-                pItImp = new MapIteratorImp;
-                pItImp->InitBegin(static_cast<MapImp*>(TYPE_IMP));
-                break;
-            default:
-                break;
-            }
-
-            it.m_pImp = pItImp;
+        case Node::SequenceType:
+            it.m_Type = Iterator::SequenceType;
+            it.m_pImp = TYPE_IMP;
+            break;
+        case Node::MapType:
+            it.m_Type = Iterator::MapType;
+            it.m_pImp = TYPE_IMP;
+            break;
+        default:
+            break;
         }
 
         return it;
@@ -1126,27 +1045,18 @@ namespace Yaml
     {
         ConstIterator it;
 
-        if(TYPE_IMP != nullptr)
+        switch(Type())
         {
-            IteratorImp * pItImp = nullptr;
-
-            switch(NODE_IMP->m_Type)
-            {
-            case Node::SequenceType:
-                it.m_Type = ConstIterator::SequenceType;
-                pItImp = new SequenceConstIteratorImp;
-                pItImp->InitBegin(static_cast<SequenceImp*>(TYPE_IMP));
-                break;
-            case Node::MapType:
-                it.m_Type = ConstIterator::MapType;
-                pItImp = new MapConstIteratorImp;
-                pItImp->InitBegin(static_cast<MapImp*>(TYPE_IMP));
-                break;
-            default:
-                break;
-            }
-
-            it.m_pImp = pItImp;
+        case Node::SequenceType:
+            it.m_Type = ConstIterator::SequenceType;
+            it.m_pImp = TYPE_IMP;
+            break;
+        case Node::MapType:
+            it.m_Type = ConstIterator::MapType;
+            it.m_pImp = TYPE_IMP;
+            break;
+        default:
+            break;
         }
 
         return it;
@@ -1154,79 +1064,186 @@ namespace Yaml
 
     Iterator Node::End()
     {
-       Iterator it;
+        Iterator it = Begin();
+        it.m_Index = Size();
+        return it;
+    }
 
-        if(TYPE_IMP != nullptr)
+    ConstIterator Node::End() const
+    {
+        ConstIterator it = Begin();
+        it.m_Index = Size();
+        return it;
+    }
+
+    std::string_view Node::AsStringView() const
+    {
+        if(TYPE_IMP == nullptr)
         {
-            IteratorImp * pItImp = nullptr;
+            return std::string_view();
+        }
 
-            switch(NODE_IMP->m_Type)
-            {
-            case Node::SequenceType:
-                it.m_Type = Iterator::SequenceType;
-                pItImp = new SequenceIteratorImp;
-                pItImp->InitEnd(static_cast<SequenceImp*>(TYPE_IMP));
-                break;
-            case Node::MapType:
-                it.m_Type = Iterator::MapType;
-                pItImp = new MapIteratorImp;
-                pItImp->InitEnd(static_cast<MapImp*>(TYPE_IMP));
-                break;
-            default:
-                break;
-            }
+        return TYPE_IMP->GetData();
+    }
 
-            it.m_pImp = pItImp;
+    const impl::CachedValue * Node::Convert(const impl::CacheKind kind) const
+    {
+        if(Type() != Node::ScalarType)
+        {
+            return nullptr;
         }
 
-        return it;
+        const ScalarImp * pScalar = static_cast<const ScalarImp*>(TYPE_IMP);
+        impl::CachedValue & cached = pScalar->m_Cache;
+        if(cached.Kind == kind)
+        {
+            return &cached;
+        }
+
+        const std::string_view data = pScalar->m_Value;
+        cached.Kind = kind;
+        switch(kind)
+        {
+        case impl::CacheKind::Signed:
+            cached.Valid = impl::ParseNumber(data, cached.Signed);
+            break;
+        case impl::CacheKind::Unsigned:
+            cached.Valid = impl::ParseNumber(data, cached.Unsigned);
+            break;
+        case impl::CacheKind::Float:
+            cached.Valid = impl::ParseNumber(data, cached.Float);
+            break;
+        case impl::CacheKind::Bool:
+            cached.Bool = impl::ParseBool(data);
+            cached.Valid = true;
+            break;
+        default:
+            cached.Valid = false;
+            break;
+        }
+        return &cached;
     }
 
-    ConstIterator Node::End() const
+    void Node::CopyFrom(const Node & node)
+    {
+        m_Line = node.m_Line;
+        switch(node.Type())
+        {
+        case Node::SequenceType:
+        {
+            SequenceImp * pSequence = InitImp<SequenceImp>(m_pImp, m_pArena, SequenceType);
+            pSequence->m_Sequence.reserve(node.Size());
+            for(auto it = node.Begin(); it != node.End(); it++)
+            {
+                pSequence->PushBack()->CopyFrom((*it).second);
+            }
+        }
+            break;
+        case Node::MapType:
+        {
+            MapImp * pMap = InitImp<MapImp>(m_pImp, m_pArena, MapType);
+            for(auto it = node.Begin(); it != node.End(); it++)
+            {
+                pMap->GetNode((*it).first)->CopyFrom((*it).second);
+            }
+        }
+            break;
+        case Node::ScalarType:
+            InitImp<ScalarImp>(m_pImp, m_pArena, ScalarType)->SetData(node.AsStringView());
+            break;
+        case Node::None:
+            break;
+        }
+    }
+
+
+
+    // Reader implementations
+    /**
+    * @breif Memory mapped, read-only view of a whole file.
+    *
+    */
+    class MappedFile
     {
-       ConstIterator it;
 
-        if(TYPE_IMP != nullptr)
+    public:
+
+        explicit MappedFile(const char * filename)
         {
-            IteratorImp * pItImp = nullptr;
+#ifdef _WIN32
+            std::ifstream f(filename, std::ifstream::binary);
+            if(f.is_open() == false)
+            {
+                return;
+            }
+            m_Data.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+            m_View = m_Data;
+            m_Open = true;
+#else
+            const int fd = open(filename, O_RDONLY);
+            if(fd < 0)
+            {
+                return;
+            }
 
-            switch(NODE_IMP->m_Type)
+            struct stat info;
+            if(fstat(fd, &info) == 0 && S_ISREG(info.st_mode))
             {
-            case Node::SequenceType:
-                it.m_Type = ConstIterator::SequenceType;
-                pItImp = new SequenceConstIteratorImp;
-                pItImp->InitEnd(static_cast<SequenceImp*>(TYPE_IMP));
-                break;
-            case Node::MapType:
-                it.m_Type = ConstIterator::MapType;
-                pItImp = new MapConstIteratorImp;
-                pItImp->InitEnd(static_cast<MapImp*>(TYPE_IMP));
-                break;
-            default:
-                break;
+                const size_t size = static_cast<size_t>(info.st_size);
+                if(size == 0)
+                {
+                    m_Open = true;
+                }
+                else
+                {
+                    void * pData = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if(pData != MAP_FAILED)
+                    {
+                        m_View = std::string_view(static_cast<const char*>(pData), size);
+                        m_Open = true;
+                    }
+                }
             }
+            close(fd);
+#endif
+        }
 
-            it.m_pImp = pItImp;
+        ~MappedFile()
+        {
+#ifndef _WIN32
+            if(m_View.size())
+            {
+                munmap(const_cast<char*>(m_View.data()), m_View.size());
+            }
+#endif
         }
 
-        return it;
-    }
+        MappedFile(const MappedFile &) = delete;
+        MappedFile & operator = (const MappedFile &) = delete;
 
-    const std::string & Node::AsString() const
-    {
-        if(TYPE_IMP == nullptr)
+        bool IsOpen() const
         {
-            return g_EmptyString;
+            return m_Open;
         }
 
-        return TYPE_IMP->GetData();
-    }
+        std::string_view View() const
+        {
+            return m_View;
+        }
 
+    private:
 
+        bool                m_Open = false;
+        std::string_view    m_View;
+#ifdef _WIN32
+        std::string         m_Data;
+#endif
+
+    };
 
-    // Reader implementations
     /**
     * @breif Line information structure.
+    *        Data views the parsed buffer, or a key string owned by the parser.
     *
     */
     class ReaderLine
@@ -1238,7 +1255,7 @@ namespace Yaml
         * @breif Constructor.
         *
         */
-        ReaderLine(const std::string & data = "",
+        ReaderLine(const std::string_view data = std::string_view(),
                    const size_t no = 0,
                    const size_t offset = 0,
                    const Node::eType type = Node::None,
@@ -1247,8 +1264,7 @@ namespace Yaml
             No(no),
             Offset(offset),
             Type(type),
-            Flags(flags),
-            NextLine(nullptr)
+            Flags(flags)
         {
         }
 
@@ -1308,7 +1324,7 @@ namespace Yaml
         * @breif Copy and replace scalar flags from another ReaderLine.
         *
         */
-        void CopyScalarFlags(ReaderLine * from)
+        void CopyScalarFlags(const ReaderLine * from)
         {
             if (from == nullptr)
             {
@@ -1321,14 +1337,11 @@ namespace Yaml
 
         static const unsigned char FlagMask[3];
 
-        std::string     Data;       ///< Data of line.
-        size_t          No;         ///< Line number.
-        size_t          Offset;     ///< Offset to first character in data.
-        Node::eType     Type;       ///< Type of line.
-        unsigned char   Flags;      ///< Flags of line.
-        ReaderLine *    NextLine;   ///< Pointer to next line.
-
-
+        std::string_view    Data;       ///< Data of line.
+        size_t              No;         ///< Line number.
+        size_t              Offset;     ///< Offset to first character in data.
+        Node::eType         Type;       ///< Type of line.
+        unsigned char       Flags;      ///< Flags of line.
 
     };
 
@@ -1337,7 +1350,11 @@ namespace Yaml
 
     /**
     * @breif Implementation class of Yaml parsing.
-    *        Parsing incoming stream and outputs a root node.
+    *        Streams the input: raw lines are read on demand, split into key, value
+    *        and sequence entry lines, and turned into events for a handler.
+    *        Only lines still needed for lookahead are held, so memory follows the
+    *        nesting depth rather than the document size. Lines view the input,
+    *        which must outlive the parse.
     *
     */
     class ParseImp
@@ -1346,112 +1363,173 @@ namespace Yaml
     public:
 
         /**
-        * @breif Default constructor.
+        * @breif Constructor.
+        *
+        */
+        explicit ParseImp(EventHandler & handler) :
+            m_Handler(handler)
+        {
+        }
+
+        /**
+        * @breif Run full parsing procedure.
+        *
+        * @return Number of input bytes consumed, less than the input size if
+        *         another document follows.
         *
         */
-        ParseImp()
+        size_t Parse(const std::string_view input)
         {
+            m_Input = input;
+            m_Consumed = input.size();
+            FindDocumentStart();
+            ParseRoot();
+            return m_Consumed;
         }
 
+    private:
+
         /**
-        * @breif Destructor.
+        * @breif Copy constructor.
         *
         */
-        ~ParseImp()
+        ParseImp(const ParseImp & copy) :
+            m_Handler(copy.m_Handler)
         {
-            ClearLines();
+
         }
 
         /**
-        * @breif Run full parsing procedure.
+        * @breif Skip anything before the first "---" line, if there is one.
+        *        Only lines starting like a marker are looked at; ReadLine
+        *        validates the lines of the document itself.
         *
         */
-        void Parse(Node & root, std::iostream & stream)
+        void FindDocumentStart()
         {
-            try
+            size_t pos = 0;
+            size_t lineNo = 0;
+            while (pos < m_Input.size())
             {
-                root.Clear();
-                ReadLines(stream);
-                PostProcessLines();
-                //Print();
-                ParseRoot(root);
-            }
-            catch(Exception e)
-            {
-                root.Clear();
-                throw;
+                const size_t lineStart = pos;
+                size_t lineEnd = m_Input.find('\n', pos);
+                const bool finalLine = lineEnd == std::string_view::npos;
+                if (finalLine)
+                {
+                    lineEnd = m_Input.size();
+                }
+                pos = std::min(lineEnd + 1, m_Input.size());
+                lineNo++;
+
+                std::string_view line = m_Input.substr(lineStart, lineEnd - lineStart);
+                if (line.starts_with("---") == false && line.starts_with("...") == false)
+                {
+                    continue;
+                }
+
+                const size_t commentPos = FindNotCited(line, '#');
+                if(commentPos != std::string_view::npos)
+                {
+                    line = line.substr(0, commentPos);
+                }
+
+                if (line == "...")
+                {
+                    return;
+                }
+                if (line == "---")
+                {
+                    // Lines before this one are not part of the document.
+                    m_FoundFirstNotEmpty = HasContent(m_Input.substr(0, lineStart));
+                    m_Pos = pos;
+                    m_LineNo = lineNo;
+                    m_FinalLine = finalLine;
+                    return;
+                }
             }
         }
 
-    private:
-
         /**
-        * @breif Copy constructor.
+        * @breif Whether any line of input holds something besides spaces and comments.
         *
         */
-        ParseImp(const ParseImp & copy)
+        static bool HasContent(std::string_view input)
         {
+            while (input.empty() == false)
+            {
+                const size_t lineEnd = input.find('\n');
+                std::string_view line = input.substr(0, lineEnd);
+                input.remove_prefix(lineEnd == std::string_view::npos ? input.size() : lineEnd + 1);
 
+                const size_t commentPos = FindNotCited(line, '#');
+                if(commentPos != std::string_view::npos)
+                {
+                    line = line.substr(0, commentPos);
+                }
+                if (line.size() && line.back() == '\r')
+                {
+                    line.remove_suffix(1);
+                }
+                if (line.find_first_not_of(" \t") != std::string_view::npos)
+                {
+                    return true;
+                }
+            }
+            return false;
         }
 
         /**
-        * @breif Read all lines.
+        * @breif Read next line.
         *        Ignoring:
-        *           - Empty lines.
+        *           - Empty lines before the first line with content.
         *           - Comments.
         *           - Document start/end.
         *
+        * @return false at the end of the document.
+        *
         */
-        void ReadLines(std::iostream & stream)
+        bool ReadLine(ReaderLine & out)
         {
-            std::string     line = "";
-            size_t          lineNo = 0;
-            bool            documentStartFound = false;
-            bool            foundFirstNotEmpty = false;
-            std::streampos  streamPos = 0;
-
-            // Read all lines, as long as the stream is ok.
-            while (!stream.eof() && !stream.fail())
+            // Like getline, the text after the final newline counts as a line, even if empty.
+            while (m_InputEnded == false && m_FinalLine == false)
             {
                 // Read line
-                streamPos = stream.tellg();
-                std::getline(stream, line);
-                lineNo++;
-
-                // Remove comment
-                const size_t commentPos = FindNotCited(line, '#');
-                if(commentPos != std::string::npos)
+                const size_t lineStart = m_Pos;
+                size_t lineEnd = m_Input.find('\n', m_Pos);
+                if (lineEnd == std::string_view::npos)
                 {
-                    line.resize(commentPos);
+                    lineEnd = m_Input.size();
+                    m_FinalLine = true;
                 }
+                m_Pos = std::min(lineEnd + 1, m_Input.size());
+                std::string_view line = m_Input.substr(lineStart, lineEnd - lineStart);
+                m_LineNo++;
 
-                // Start of document.
-                if (documentStartFound == false && line == "---")
+                // Remove comment
+                const size_t commentPos = FindNotCited(line, '#');
+                if(commentPos != std::string_view::npos)
                 {
-                    // Erase all lines before this line.
-                    ClearLines();
-                    documentStartFound = true;
-                    continue;
+                    line = line.substr(0, commentPos);
                 }
 
-                // End of document.
+                // End of document. FindDocumentStart has already skipped past the "---" that starts it.
                 if (line == "...")
                 {
+                    m_Consumed = m_Pos;
+                    m_InputEnded = true;
                     break;
                 }
                 else if(line == "---")
                 {
-                    stream.seekg(streamPos);
+                    m_Consumed = lineStart;
+                    m_InputEnded = true;
                     break;
                 }
 
                 // Remove trailing return.
-                if (line.size())
+                if (line.size() && line.back() == '\r')
                 {
-                    if (line[line.size() - 1] == '\r')
-                    {
-                        line.resize(line.size() - 1);
-                    }
+                    line.remove_suffix(1);
                 }
 
                 // Validate characters.
@@ -1459,7 +1537,7 @@ namespace Yaml
                 {
                     if (line[i] != '\t' && (line[i] < 32 || line[i] > 125))
                     {
-                        throw ParsingException(ExceptionMessage(g_ErrorInvalidCharacter, lineNo, i + 1));
+                        throw ParsingException(ExceptionMessage(g_ErrorInvalidCharacter, m_LineNo, i + 1));
                     }
                 }
 
@@ -1468,28 +1546,28 @@ namespace Yaml
                 size_t       startOffset    = line.find_first_not_of(" \t");
 
                 // Make sure no tabs are in the very front.
-                if (startOffset != std::string::npos)
+                if (startOffset != std::string_view::npos)
                 {
                     if(firstTabPos < startOffset)
                     {
-                        throw ParsingException(ExceptionMessage(g_ErrorTabInOffset, lineNo, firstTabPos));
+                        throw ParsingException(ExceptionMessage(g_ErrorTabInOffset, m_LineNo, firstTabPos));
                     }
 
                     // Remove front spaces.
-                    line = line.substr(startOffset);
+                    line.remove_prefix(startOffset);
                 }
                 else
                 {
                     startOffset = 0;
-                    line = "";
+                    line = std::string_view();
                 }
 
                 // Add line.
-                if(foundFirstNotEmpty == false)
+                if(m_FoundFirstNotEmpty == false)
                 {
                     if(line.size())
                     {
-                        foundFirstNotEmpty = true;
+                        m_FoundFirstNotEmpty = true;
                     }
                     else
                     {
@@ -1497,170 +1575,192 @@ namespace Yaml
                     }
                 }
 
-                ReaderLine * pLine = new ReaderLine(line, lineNo, startOffset);
-                m_Lines.push_back(pLine);
+                out = ReaderLine(line, m_LineNo, startOffset);
+                return true;
+            }
+
+            m_InputEnded = true;
+            return false;
+        }
+
+        /**
+        * @breif Peek at the next raw line, nullptr at the end of the document.
+        *
+        */
+        const ReaderLine * PeekRaw()
+        {
+            if(m_HasRawPeek == false)
+            {
+                m_HasRawPeek = ReadLine(m_RawPeek);
+            }
+            return m_HasRawPeek ? &m_RawPeek : nullptr;
+        }
+
+        bool NextRaw(ReaderLine & line)
+        {
+            if(PeekRaw() == nullptr)
+            {
+                return false;
             }
+            line = m_RawPeek;
+            m_HasRawPeek = false;
+            return true;
         }
 
         /**
-        * @breif Run post-processing on all lines.
+        * @breif Post-process raw lines until index lines are queued or the document ends.
         *        Basically split lines into multiple lines if needed, to follow the parsing algorithm.
         *
         */
-        void PostProcessLines()
+        void Fill(const size_t index)
         {
-            for (auto it = m_Lines.begin(); it != m_Lines.end();)
+            ReaderLine line;
+            while (m_Lines.size() <= index && m_PostProcessDone == false)
             {
+                if(NextRaw(line) == false)
+                {
+                    m_PostProcessDone = true;
+                    if (m_HasLastLine && m_LastLine.Type != Node::ScalarType)
+                    {
+                        throw ParsingException(ExceptionMessage(g_ErrorUnexpectedDocumentEnd, m_LastLine));
+                    }
+                    break;
+                }
+
                 // Sequence.
-                if (PostProcessSequenceLine(it) == true)
+                if (PostProcessSequenceLine(line) == true)
                 {
                     continue;
                 }
 
                 // Mapping.
-                if (PostProcessMappingLine(it) == true)
+                if (PostProcessMappingLine(line) == true)
                 {
                     continue;
                 }
 
                 // Scalar.
-                PostProcessScalarLine(it);
+                PostProcessScalarLine(line);
             }
+        }
 
-            // Set next line of all lines.
-            if (m_Lines.size())
-            {
-                if (m_Lines.back()->Type != Node::ScalarType)
-                {
-                    throw ParsingException(ExceptionMessage(g_ErrorUnexpectedDocumentEnd, *m_Lines.back()));
-                }
-
-                if (m_Lines.size() > 1)
-                {
-                    auto prevEnd = m_Lines.end();
-                    --prevEnd;
-
-                    for (auto it = m_Lines.begin(); it != prevEnd; it++)
-                    {
-                        auto nextIt = it;
-                        ++nextIt;
-
-                        (*it)->NextLine = *nextIt;
-                    }
-                }
-            }
+        void Emit(const ReaderLine & line)
+        {
+            m_Lines.push_back(line);
+            m_LastLine = line;
+            m_HasLastLine = true;
         }
 
         /**
         * @breif Run post-processing and check for sequence.
-        *        Split line into two lines if sequence token is not on it's own line.
+        *        Split line into two lines if sequence token is not on it's own line,
+        *        leaving the value in line.
         *
         * @return true if line is sequence, else false.
         *
         */
-        bool PostProcessSequenceLine(std::list<ReaderLine *>::iterator & it)
+        bool PostProcessSequenceLine(ReaderLine & line)
         {
-            ReaderLine * pLine = *it;
-
             // Sequence split
-            if (IsSequenceStart(pLine->Data) == false)
+            if (IsSequenceStart(line.Data) == false)
             {
                 return false;
             }
 
-            pLine->Type = Node::SequenceType;
+            line.Type = Node::SequenceType;
 
-            ClearTrailingEmptyLines(++it);
+            SkipEmptyLines();
 
-            const size_t valueStart = pLine->Data.find_first_not_of(" \t", 1);
-            if (valueStart == std::string::npos)
+            const size_t valueStart = line.Data.find_first_not_of(" \t", 1);
+            if (valueStart == std::string_view::npos)
             {
+                Emit(line);
                 return true;
             }
 
-            // Create new line and insert
-            std::string newLine = pLine->Data.substr(valueStart);
-            it = m_Lines.insert(it, new ReaderLine(newLine, pLine->No, pLine->Offset + valueStart));
-            pLine->Data = "";
+            // Emit the sequence entry and continue with its value.
+            ReaderLine valueLine(line.Data.substr(valueStart), line.No, line.Offset + valueStart);
+            line.Data = std::string_view();
+            Emit(line);
+            line = valueLine;
 
             return false;
         }
 
         /**
         * @breif Run post-processing and check for mapping.
-        *        Split line into two lines if mapping value is not on it's own line.
+        *        Split line into two lines if mapping value is not on it's own line,
+        *        leaving the value in line. Escapes in keys are removed when parsing.
         *
         * @return true if line is mapping, else move on to scalar parsing.
         *
         */
-        bool PostProcessMappingLine(std::list<ReaderLine *>::iterator & it)
+        bool PostProcessMappingLine(ReaderLine & line)
         {
-            ReaderLine * pLine = *it;
-
             // Find map key.
             size_t preKeyQuotes = 0;
-            size_t tokenPos = FindNotCited(pLine->Data, ':', preKeyQuotes);
-            if (tokenPos == std::string::npos)
+            size_t tokenPos = FindNotCited(line.Data, ':', preKeyQuotes);
+            if (tokenPos == std::string_view::npos)
             {
                 return false;
             }
             if(preKeyQuotes > 1)
             {
-                throw ParsingException(ExceptionMessage(g_ErrorKeyIncorrect, *pLine));
+                throw ParsingException(ExceptionMessage(g_ErrorKeyIncorrect, line));
             }
 
-            pLine->Type = Node::MapType;
+            line.Type = Node::MapType;
 
             // Get key
-            std::string key = pLine->Data.substr(0, tokenPos);
+            std::string_view key = line.Data.substr(0, tokenPos);
             const size_t keyEnd = key.find_last_not_of(" \t");
-            if (keyEnd == std::string::npos)
+            if (keyEnd == std::string_view::npos)
             {
-                throw ParsingException(ExceptionMessage(g_ErrorKeyMissing, *pLine));
+                throw ParsingException(ExceptionMessage(g_ErrorKeyMissing, line));
             }
-            key.resize(keyEnd + 1);
+            key = key.substr(0, keyEnd + 1);
 
             // Handle cited key.
             if(preKeyQuotes == 1)
             {
                 if(key.front() != '"' || key.back() != '"')
                 {
-                    throw ParsingException(ExceptionMessage(g_ErrorKeyIncorrect, *pLine));
+                    throw ParsingException(ExceptionMessage(g_ErrorKeyIncorrect, line));
                 }
 
                 key = key.substr(1, key.size() - 2);
             }
-            RemoveAllEscapeTokens(key);
 
             // Get value
-            std::string value = "";
-            size_t valueStart = std::string::npos;
-            if (tokenPos + 1 != pLine->Data.size())
+            std::string_view value;
+            size_t valueStart = std::string_view::npos;
+            if (tokenPos + 1 != line.Data.size())
             {
-                valueStart = pLine->Data.find_first_not_of(" \t", tokenPos + 1);
-                if (valueStart != std::string::npos)
+                valueStart = line.Data.find_first_not_of(" \t", tokenPos + 1);
+                if (valueStart != std::string_view::npos)
                 {
-                    value = pLine->Data.substr(valueStart);
+                    value = line.Data.substr(valueStart);
                 }
             }
 
             // Make sure the value is not a sequence start.
             if (IsSequenceStart(value) == true)
             {
-                throw ParsingException(ExceptionMessage(g_ErrorBlockSequenceNotAllowed, *pLine, valueStart));
+                throw ParsingException(ExceptionMessage(g_ErrorBlockSequenceNotAllowed, line, valueStart));
             }
 
-            pLine->Data = key;
-
+            line.Data = key;
+            Emit(line);
 
             // Remove all empty lines after map key.
-            ClearTrailingEmptyLines(++it);
+            SkipEmptyLines();
 
             // Add new empty line?
             size_t newLineOffset = valueStart;
-            if(newLineOffset == std::string::npos)
+            if(newLineOffset == std::string_view::npos)
             {
-                if(it != m_Lines.end() && (*it)->Offset > pLine->Offset)
+                const ReaderLine * pNext = PeekRaw();
+                if(pNext != nullptr && pNext->Offset > line.Offset)
                 {
                     return true;
                 }
@@ -1669,17 +1769,16 @@ namespace Yaml
             }
             else
             {
-                newLineOffset += pLine->Offset;
+                newLineOffset += line.Offset;
             }
 
-            // Add new line with value.
+            // Continue with the value line.
             unsigned char dummyBlockFlags = 0;
-            if(IsBlockScalar(value, pLine->No, dummyBlockFlags) == true)
+            if(IsBlockScalar(value, line.No, dummyBlockFlags) == true)
             {
-                newLineOffset = pLine->Offset;
+                newLineOffset = line.Offset;
             }
-            ReaderLine * pNewLine = new ReaderLine(value, pLine->No, newLineOffset, Node::ScalarType);
-            it = m_Lines.insert(it, pNewLine);
+            line = ReaderLine(value, line.No, newLineOffset, Node::ScalarType);
 
             // Return false in order to handle next line(scalar value).
             return false;
@@ -1689,127 +1788,154 @@ namespace Yaml
         * @breif Run post-processing and check for scalar.
         *        Checking for multi-line scalars.
         *
-        * @return true if scalar search should continue, else false.
-        *
         */
-        void PostProcessScalarLine(std::list<ReaderLine *>::iterator & it)
+        void PostProcessScalarLine(ReaderLine & line)
         {
-            ReaderLine * pLine = *it;
-            pLine->Type = Node::ScalarType;
+            line.Type = Node::ScalarType;
 
-            size_t parentOffset = pLine->Offset;
-            if(pLine != m_Lines.front())
+            size_t parentOffset = line.Offset;
+            if(m_HasLastLine)
             {
-                 std::list<ReaderLine *>::iterator lastIt = it;
-                --lastIt;
-                parentOffset = (*lastIt)->Offset;
+                parentOffset = m_LastLine.Offset;
             }
 
-           std::list<ReaderLine *>::iterator lastNotEmpty = it++;
+            Emit(line);
 
-            // Find last empty lines
-            while(it != m_Lines.end())
+            // Take every more indented line, keeping inner empty lines and dropping trailing ones.
+            const ReaderLine * pNext = nullptr;
+            while((pNext = PeekRaw()) != nullptr)
             {
-                pLine = *it;
-                pLine->Type = Node::ScalarType;
-                if(pLine->Data.size())
+                if(pNext->Data.size() == 0)
                 {
-                    if(pLine->Offset <= parentOffset)
-                    {
-                        break;
-                    }
-                    else
-                    {
-                        lastNotEmpty = it;
-                    }
+                    m_EmptyLines.push_back(*pNext);
+                    m_HasRawPeek = false;
+                    continue;
+                }
+                if(pNext->Offset <= parentOffset)
+                {
+                    break;
+                }
+
+                for(auto it = m_EmptyLines.begin(); it != m_EmptyLines.end(); it++)
+                {
+                    it->Type = Node::ScalarType;
+                    Emit(*it);
                 }
-                ++it;
+                m_EmptyLines.clear();
+
+                ReaderLine continuation = *pNext;
+                m_HasRawPeek = false;
+                continuation.Type = Node::ScalarType;
+                Emit(continuation);
+            }
+            m_EmptyLines.clear();
+        }
+
+        void SkipEmptyLines()
+        {
+            const ReaderLine * pNext = nullptr;
+            while((pNext = PeekRaw()) != nullptr && pNext->Data.size() == 0)
+            {
+                m_HasRawPeek = false;
             }
+        }
+
+        /**
+        * @breif Get queued line by index, nullptr at the end of the document.
+        *
+        */
+        const ReaderLine * Peek(const size_t index = 0)
+        {
+            Fill(index);
+            return index < m_Lines.size() ? &m_Lines[index] : nullptr;
+        }
 
-            ClearTrailingEmptyLines(++lastNotEmpty);
+        /**
+        * @breif Consume the next line, which must exist.
+        *
+        */
+        const ReaderLine & Take()
+        {
+            Fill(0);
+            m_Previous = m_Lines.front();
+            m_HasPrevious = true;
+            m_Lines.pop_front();
+            return m_Previous;
         }
 
         /**
         * @breif Process root node and start of document.
         *
         */
-        void ParseRoot(Node & root)
+        void ParseRoot()
         {
             // Get first line and start type.
-            auto it = m_Lines.begin();
-            if(it == m_Lines.end())
+            const ReaderLine * pFirst = Peek();
+            if(pFirst == nullptr)
             {
                 return;
             }
-            Node::eType type = (*it)->Type;
-            ReaderLine * pLine = *it;
+            const ReaderLine line = *pFirst;
 
             // Handle next line.
+            ParseValue(line.Type);
+
+            if(Peek() != nullptr)
+            {
+                throw InternalException(ExceptionMessage(g_ErrorUnexpectedDocumentEnd, line));
+            }
+
+        }
+
+        void ParseValue(const Node::eType type)
+        {
             switch(type)
             {
             case Node::SequenceType:
-                ParseSequence(root, it);
+                ParseSequence();
                 break;
             case Node::MapType:
-                ParseMap(root, it);
+                ParseMap();
                 break;
             case Node::ScalarType:
-                ParseScalar(root, it);
+                ParseScalar();
                 break;
             default:
                 break;
             }
-
-            if(it != m_Lines.end())
-            {
-                throw InternalException(ExceptionMessage(g_ErrorUnexpectedDocumentEnd, *pLine));
-            }
-
         }
 
         /**
         * @breif Process sequence node.
         *
         */
-        void ParseSequence(Node & node, std::list<ReaderLine *>::iterator & it)
+        void ParseSequence()
         {
-            ReaderLine * pNextLine = nullptr;
-            while(it != m_Lines.end())
+            m_Handler.m_Line = Peek()->No;
+            m_Handler.StartSequence();
+
+            while(Peek() != nullptr)
             {
-                ReaderLine * pLine = *it;
-                Node & childNode = node.PushBack();
+                const ReaderLine line = Take();
 
                 // Move to next line, error check.
-                ++it;
-                if(it == m_Lines.end())
+                const ReaderLine * pValue = Peek();
+                if(pValue == nullptr)
                 {
-                    throw InternalException(ExceptionMessage(g_ErrorUnexpectedDocumentEnd, *pLine));
+                    throw InternalException(ExceptionMessage(g_ErrorUnexpectedDocumentEnd, line));
                 }
 
                 // Handle value of map
-                Node::eType valueType = (*it)->Type;
-                switch(valueType)
-                {
-                case Node::SequenceType:
-                    ParseSequence(childNode, it);
-                    break;
-                case Node::MapType:
-                    ParseMap(childNode, it);
-                    break;
-                case Node::ScalarType:
-                    ParseScalar(childNode, it);
-                    break;
-                default:
-                    break;
-                }
+                ParseValue(pValue->Type);
 
                 // Check next line. if sequence and correct level, go on, else exit.
                 // If same level but but of type map = error.
-                if(it == m_Lines.end() || ((pNextLine = *it)->Offset < pLine->Offset))
+                const ReaderLine * pNextLine = Peek();
+                if(pNextLine == nullptr || pNextLine->Offset < line.Offset)
                 {
                     break;
                 }
-                if(pNextLine->Offset > pLine->Offset)
+                if(pNextLine->Offset > line.Offset)
                 {
                     throw ParsingException(ExceptionMessage(g_ErrorIncorrectOffset, *pNextLine));
                 }
@@ -1819,157 +1945,160 @@ namespace Yaml
                 }
 
             }
+
+            m_Handler.EndSequence();
         }
 
         /**
         * @breif Process map node.
         *
         */
-        void ParseMap(Node & node, std::list<ReaderLine *>::iterator & it)
+        void ParseMap()
         {
-            ReaderLine * pNextLine = nullptr;
-            while(it != m_Lines.end())
+            m_Handler.m_Line = Peek()->No;
+            m_Handler.StartMap();
+
+            std::string unescaped;
+            while(Peek() != nullptr)
             {
-                ReaderLine * pLine = *it;
-                Node & childNode = node[pLine->Data];
+                const ReaderLine line = Take();
+                m_Handler.m_Line = line.No;
+                if(line.Data.find('\\') == std::string_view::npos)
+                {
+                    m_Handler.Key(line.Data);
+                }
+                else
+                {
+                    unescaped.assign(line.Data);
+                    RemoveAllEscapeTokens(unescaped);
+                    m_Handler.Key(unescaped);
+                }
 
                 // Move to next line, error check.
-                ++it;
-                if(it == m_Lines.end())
+                const ReaderLine * pValue = Peek();
+                if(pValue == nullptr)
                 {
-                    throw InternalException(ExceptionMessage(g_ErrorUnexpectedDocumentEnd, *pLine));
+                    throw InternalException(ExceptionMessage(g_ErrorUnexpectedDocumentEnd, line));
                 }
 
                 // Handle value of map
-                Node::eType valueType = (*it)->Type;
-                switch(valueType)
-                {
-                case Node::SequenceType:
-                    ParseSequence(childNode, it);
-                    break;
-                case Node::MapType:
-                    ParseMap(childNode, it);
-                    break;
-                case Node::ScalarType:
-                    ParseScalar(childNode, it);
-                    break;
-                default:
-                    break;
-                }
+                ParseValue(pValue->Type);
 
                 // Check next line. if map and correct level, go on, else exit.
                 // if same level but but of type map = error.
-                if(it == m_Lines.end() || ((pNextLine = *it)->Offset < pLine->Offset))
+                const ReaderLine * pNextLine = Peek();
+                if(pNextLine == nullptr || pNextLine->Offset < line.Offset)
                 {
                     break;
                 }
-                if(pNextLine->Offset > pLine->Offset)
+                if(pNextLine->Offset > line.Offset)
                 {
                     throw ParsingException(ExceptionMessage(g_ErrorIncorrectOffset, *pNextLine));
                 }
-                if(pNextLine->Type != pLine->Type)
+                if(pNextLine->Type != line.Type)
                 {
                     throw InternalException(ExceptionMessage(g_ErrorDiffEntryNotAllowed, *pNextLine));
                 }
 
             }
+
+            m_Handler.EndMap();
         }
 
         /**
         * @breif Process scalar node.
+        *        Single line scalars are passed on as views of the input.
         *
         */
-        void ParseScalar(Node & node, std::list<ReaderLine *>::iterator & it)
+        void ParseScalar()
         {
-            std::string data = "";
-            ReaderLine * pFirstLine = *it;
-            ReaderLine * pLine = *it;
+            // Find parent offset
+            const size_t parentOffset = m_HasPrevious ? m_Previous.Offset : 0;
+
+            const ReaderLine first = Take();
+            m_Handler.m_Line = first.No;
 
             // Check if current line is a block scalar.
             unsigned char blockFlags = 0;
-            bool isBlockScalar = IsBlockScalar(pLine->Data, pLine->No, blockFlags);
+            bool isBlockScalar = IsBlockScalar(first.Data, first.No, blockFlags);
             const bool newLineFlag = static_cast<bool>(blockFlags & ReaderLine::FlagMask[static_cast<size_t>(ReaderLine::ScalarNewlineFlag)]);
             const bool foldedFlag = static_cast<bool>(blockFlags & ReaderLine::FlagMask[static_cast<size_t>(ReaderLine::FoldedScalarFlag)]);
             const bool literalFlag = static_cast<bool>(blockFlags & ReaderLine::FlagMask[static_cast<size_t>(ReaderLine::LiteralScalarFlag)]);
-            size_t parentOffset = 0;
 
-            // Find parent offset
-            if(it != m_Lines.begin())
+            // Move to next line if current line is a block scalar.
+            // A block scalar without lines leaves the value empty.
+            const ReaderLine * pNext = Peek();
+            if(isBlockScalar && (pNext == nullptr || pNext->Type != Node::ScalarType))
             {
-                std::list<ReaderLine *>::iterator parentIt = it;
-                --parentIt;
-                parentOffset = (*parentIt)->Offset;
+                m_Handler.Null();
+                return;
             }
 
-            // Move to next iterator/line if current line is a block scalar.
-            if(isBlockScalar)
-            {
-                ++it;
-                if(it == m_Lines.end() || (pLine = *it)->Type != Node::ScalarType)
-                {
-                    return;
-                }
-            }
+            std::string data;
+            std::string_view value;
 
             // Not a block scalar, cut end spaces/tabs
             if(isBlockScalar == false)
             {
+                ReaderLine line = first;
+                bool multiLine = false;
                 while(1)
                 {
-                    pLine = *it;
-
-                    if(parentOffset != 0 && pLine->Offset <= parentOffset)
+                    if(parentOffset != 0 && line.Offset <= parentOffset)
                     {
-                        throw ParsingException(ExceptionMessage(g_ErrorIncorrectOffset, *pLine));
+                        throw ParsingException(ExceptionMessage(g_ErrorIncorrectOffset, line));
                     }
 
-                    const size_t endOffset = pLine->Data.find_last_not_of(" \t");
-                    if(endOffset == std::string::npos)
-                    {
-                        data += "\n";
-                    }
-                    else
+                    const size_t endOffset = line.Data.find_last_not_of(" \t");
+                    const std::string_view part = endOffset == std::string_view::npos ?
+                                                  std::string_view("\n") : line.Data.substr(0, endOffset + 1);
+
+                    // Move to next line
+                    pNext = Peek();
+                    if(multiLine == false && (pNext == nullptr || pNext->Type != Node::ScalarType))
                     {
-                        data += pLine->Data.substr(0, endOffset + 1);
+                        value = part;
+                        break;
                     }
 
-                    // Move to next line
-                    ++it;
-                    if(it == m_Lines.end() || (*it)->Type != Node::ScalarType)
+                    data += part;
+                    multiLine = true;
+                    if(pNext == nullptr || pNext->Type != Node::ScalarType)
                     {
+                        value = data;
                         break;
                     }
 
                     data += " ";
+                    line = Take();
                 }
 
-                if(ValidateQuote(data) == false)
+                if(ValidateQuote(value) == false)
                 {
-                    throw ParsingException(ExceptionMessage(g_ErrorInvalidQuote, *pFirstLine));
+                    throw ParsingException(ExceptionMessage(g_ErrorInvalidQuote, first));
                 }
             }
             // Block scalar
             else
             {
-                pLine = *it;
-                size_t blockOffset = pLine->Offset;
+                size_t blockOffset = pNext->Offset;
                 if(blockOffset <= parentOffset)
                 {
-                    throw ParsingException(ExceptionMessage(g_ErrorIncorrectOffset, *pLine));
+                    throw ParsingException(ExceptionMessage(g_ErrorIncorrectOffset, *pNext));
                 }
 
                 bool addedSpace = false;
-                while(it != m_Lines.end() && (*it)->Type == Node::ScalarType)
+                while((pNext = Peek()) != nullptr && pNext->Type == Node::ScalarType)
                 {
-                    pLine = *it;
+                    const ReaderLine & line = Take();
 
-                    const size_t endOffset = pLine->Data.find_last_not_of(" \t");
-                    if(endOffset != std::string::npos && pLine->Offset < blockOffset)
+                    const size_t endOffset = line.Data.find_last_not_of(" \t");
+                    if(endOffset != std::string_view::npos && line.Offset < blockOffset)
                     {
-                        throw ParsingException(ExceptionMessage(g_ErrorIncorrectOffset, *pLine));
+                        throw ParsingException(ExceptionMessage(g_ErrorIncorrectOffset, line));
                     }
 
-                    if(endOffset == std::string::npos)
+                    if(endOffset == std::string_view::npos)
                     {
                         if(addedSpace)
                         {
@@ -1981,12 +2110,11 @@ namespace Yaml
                             data += "\n";
                         }
 
-                        ++it;
                         continue;
                     }
                     else
                     {
-                        if(blockOffset != pLine->Offset && foldedFlag)
+                        if(blockOffset != line.Offset && foldedFlag)
                         {
                             if(addedSpace)
                             {
@@ -1998,166 +2126,43 @@ namespace Yaml
                                 data += "\n";
                             }
                         }
-                        data += std::string(pLine->Offset - blockOffset, ' ');
-                        data += pLine->Data;
+                        data.append(line.Offset - blockOffset, ' ');
+                        data += line.Data;
                     }
 
                     // Move to next line
-                    ++it;
-                    if(it == m_Lines.end() || (*it)->Type != Node::ScalarType)
+                    pNext = Peek();
+                    if(pNext == nullptr || pNext->Type != Node::ScalarType)
                     {
                         if(newLineFlag)
-                        {
-                            data += "\n";
-                        }
-                        break;
-                    }
-
-                    if(foldedFlag)
-                    {
-                        data += " ";
-                        addedSpace = true;
-                    }
-                    else if(literalFlag && endOffset != std::string::npos)
-                    {
-                        data += "\n";
-                    }
-                }
-            }
-
-            if(data.size() && (data[0] == '"' || data[0] == '\''))
-            {
-                data = data.substr(1, data.size() - 2 );
-            }
-
-            node = data;
-        }
-
-        /**
-        * @breif Debug printing.
-        *
-        */
-        void Print()
-        {
-            for (auto it = m_Lines.begin(); it != m_Lines.end(); it++)
-            {
-
-                ReaderLine * pLine = *it;
-
-                // Print type
-                if (pLine->Type == Node::SequenceType)
-                {
-                    std::cout << "seq ";
-                }
-                else if (pLine->Type == Node::MapType)
-                {
-                    std::cout << "map ";
-                }
-                else if (pLine->Type == Node::ScalarType)
-                {
-                    std::cout << "sca ";
-                }
-                else
-                {
-                    std::cout << "    ";
-                }
-
-                // Print flags
-                if (pLine->GetFlag(ReaderLine::FoldedScalarFlag))
-                {
-                    std::cout << "f";
-                }
-                else
-                {
-                    std::cout << "-";
-                }
-                if (pLine->GetFlag(ReaderLine::LiteralScalarFlag))
-                {
-                    std::cout << "l";
-                }
-                else
-                {
-                    std::cout << "-";
-                }
-                if (pLine->GetFlag(ReaderLine::ScalarNewlineFlag))
-                {
-                    std::cout << "n";
-                }
-                else
-                {
-                    std::cout << "-";
-                }
-                if (pLine->NextLine == nullptr)
-                {
-                    std::cout << "e";
-                }
-                else
-                {
-                    std::cout << "-";
-                }
-
-
-                std::cout << "| ";
-                std::cout << pLine->No << " ";
-                std::cout << std::string(pLine->Offset, ' ');
+                        {
+                            data += "\n";
+                        }
+                        break;
+                    }
 
-                if (pLine->Type == Node::ScalarType)
-                {
-                    std::string scalarValue = pLine->Data;
-                    for (size_t i = 0; (i = scalarValue.find("\n", i)) != std::string::npos;)
+                    if(foldedFlag)
                     {
-                        scalarValue.replace(i, 1, "\\n");
-                        i += 2;
+                        data += " ";
+                        addedSpace = true;
+                    }
+                    else if(literalFlag && endOffset != std::string_view::npos)
+                    {
+                        data += "\n";
                     }
-                    std::cout << scalarValue << std::endl;
-                }
-                else if (pLine->Type == Node::MapType)
-                {
-                    std::cout << pLine->Data + ":" << std::endl;
-                }
-                else if (pLine->Type == Node::SequenceType)
-                {
-                    std::cout << "-" << std::endl;
-                }
-                else
-                {
-                    std::cout << "> UNKOWN TYPE <" << std::endl;
                 }
+                value = data;
             }
-        }
 
-        /**
-        * @breif Clear all read lines.
-        *
-        */
-        void ClearLines()
-        {
-            for (auto it = m_Lines.begin(); it != m_Lines.end(); it++)
+            if(value.size() && (value[0] == '"' || value[0] == '\''))
             {
-                delete *it;
+                value = value.substr(1, value.size() - 2);
             }
-            m_Lines.clear();
-        }
-
-        void ClearTrailingEmptyLines(std::list<ReaderLine *>::iterator & it)
-        {
-            while(it != m_Lines.end())
-            {
-                ReaderLine * pLine = *it;
-                if(pLine->Data.size() == 0)
-                {
-                    delete *it;
-                    it = m_Lines.erase(it);
-                }
-                else
-                {
-                    return;
-                }
 
-            }
+            m_Handler.Scalar(value);
         }
 
-        static bool IsSequenceStart(const std::string & data)
+        static bool IsSequenceStart(const std::string_view data)
         {
             if (data.size() == 0 || data[0] != '-')
             {
@@ -2172,7 +2177,7 @@ namespace Yaml
             return true;
         }
 
-        static bool IsBlockScalar(const std::string & data, const size_t line, unsigned char & flags)
+        static bool IsBlockScalar(const std::string_view data, const size_t line, unsigned char & flags)
         {
             flags = 0;
             if(data.size() == 0)
@@ -2217,57 +2222,213 @@ namespace Yaml
             return false;
         }
 
-        std::list<ReaderLine *> m_Lines;    ///< List of lines.
+        EventHandler &          m_Handler;                      ///< Receiver of parsing events.
+
+        std::string_view        m_Input;                        ///< Whole input.
+        size_t                  m_Pos = 0;                      ///< Start of the next unread line.
+        size_t                  m_LineNo = 0;                   ///< Number of the last read line.
+        bool                    m_FinalLine = false;            ///< Input has no more newlines.
+        bool                    m_InputEnded = false;           ///< Document end reached.
+        bool                    m_FoundFirstNotEmpty = false;   ///< Leading empty lines skipped.
+        size_t                  m_Consumed = 0;                 ///< Input bytes belonging to this document.
+
+        ReaderLine              m_RawPeek;                      ///< Next raw line, if m_HasRawPeek.
+        bool                    m_HasRawPeek = false;
+        std::deque<ReaderLine>  m_EmptyLines;                   ///< Empty lines that may still end a scalar.
+
+        std::deque<ReaderLine>  m_Lines;                        ///< Post-processed lines not yet parsed.
+        bool                    m_PostProcessDone = false;
+        ReaderLine              m_LastLine;                     ///< Last post-processed line.
+        bool                    m_HasLastLine = false;
+        ReaderLine              m_Previous;                     ///< Last parsed line.
+        bool                    m_HasPrevious = false;
 
     };
 
-    // Parsing functions
-    void Parse(Node & root, const char * filename)
+    /**
+    * @breif Event handler building a Node tree.
+    *
+    */
+    class TreeBuilder : public EventHandler
     {
-        std::ifstream f(filename, std::ifstream::binary);
-        if (f.is_open() == false)
+
+    public:
+
+        explicit TreeBuilder(Node & root) :
+            m_pRoot(&root)
         {
-            throw OperationException(g_ErrorCannotOpenFile);
         }
 
-        f.seekg(0, f.end);
-        size_t fileSize = static_cast<size_t>(f.tellg());
-        f.seekg(0, f.beg);
+        virtual void StartMap()
+        {
+            m_Stack.push_back(&Located());
+        }
 
-        std::unique_ptr<char[]> data(new char[fileSize]);
-        f.read(data.get(), fileSize);
-        f.close();
+        virtual void EndMap()
+        {
+            m_Stack.pop_back();
+        }
 
-        Parse(root, data.get(), fileSize);
-    }
+        virtual void StartSequence()
+        {
+            m_Stack.push_back(&Located());
+        }
 
-    void Parse(Node & root, std::iostream & stream)
-    {
-        ParseImp * pImp = nullptr;
+        virtual void EndSequence()
+        {
+            m_Stack.pop_back();
+        }
+
+        virtual void Key(const std::string_view key)
+        {
+            m_pKeyNode = &(*m_Stack.back())[key];
+        }
+
+        virtual void Scalar(const std::string_view value)
+        {
+            Located() = value;
+        }
+
+        virtual void Null()
+        {
+            Located();
+        }
+
+    private:
+
+        /**
+        * @breif Value node, marked with the line of the current event.
+        *
+        */
+        Node & Located()
+        {
+            Node & node = Value();
+            node.m_Line = Line();
+            return node;
+        }
+
+        /**
+        * @breif Node receiving the next value: the root, the node of the last key
+        *        or a new sequence item.
+        *
+        */
+        Node & Value()
+        {
+            if(m_Stack.empty())
+            {
+                return *m_pRoot;
+            }
+            if(m_pKeyNode != nullptr)
+            {
+                Node & node = *m_pKeyNode;
+                m_pKeyNode = nullptr;
+                return node;
+            }
+            return m_Stack.back()->PushBack();
+        }
+
+        Node *              m_pRoot;
+        Node *              m_pKeyNode = nullptr;
+        std::vector<Node *> m_Stack;
 
+    };
+
+    // Parsing functions
+    static size_t ParseDocument(Node & root, const std::string_view input)
+    {
         try
         {
-            pImp = new ParseImp;
-            pImp->Parse(root, stream);
-            delete pImp;
+            root.Clear();
+            TreeBuilder builder(root);
+            return ParseImp(builder).Parse(input);
         }
-        catch (const Exception e)
+        catch(const Exception & e)
         {
-            delete pImp;
+            root.Clear();
             throw;
         }
     }
 
+    static size_t ParseDocument(EventHandler & handler, const std::string_view input)
+    {
+        return ParseImp(handler).Parse(input);
+    }
+
+    template<typename Target>
+    static void ParseFile(Target & target, const char * filename)
+    {
+        const MappedFile file(filename);
+        if (file.IsOpen() == false)
+        {
+            throw OperationException(g_ErrorCannotOpenFile);
+        }
+
+        ParseDocument(target, file.View());
+    }
+
+    template<typename Target>
+    static void ParseStream(Target & target, std::iostream & stream)
+    {
+        // Read the rest of the stream, then rewind to any following document.
+        const std::streampos start = stream.tellg();
+        const std::string data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+        const size_t consumed = ParseDocument(target, data);
+        if(consumed < data.size() && start != std::streampos(-1))
+        {
+            stream.clear();
+            stream.seekg(start + static_cast<std::streamoff>(consumed));
+        }
+    }
+
+    void Parse(Node & root, const char * filename)
+    {
+        ParseFile(root, filename);
+    }
+
+    void Parse(Node & root, std::iostream & stream)
+    {
+        ParseStream(root, stream);
+    }
+
     void Parse(Node & root, const std::string & string)
     {
-        std::stringstream ss(string);
-        Parse(root, ss);
+        ParseDocument(root, string);
     }
 
     void Parse(Node & root, const char * buffer, const size_t size)
     {
-        std::stringstream ss(std::string(buffer, size));
-        Parse(root, ss);
+        if(buffer == nullptr && size != 0)
+        {
+            throw OperationException(g_ErrorCannotOpenFile);
+        }
+
+        ParseDocument(root, std::string_view(buffer, size));
+    }
+
+    void Parse(EventHandler & handler, const char * filename)
+    {
+        ParseFile(handler, filename);
+    }
+
+    void Parse(EventHandler & handler, std::iostream & stream)
+    {
+        ParseStream(handler, stream);
+    }
+
+    void Parse(EventHandler & handler, const std::string & string)
+    {
+        ParseDocument(handler, string);
+    }
+
+    void Parse(EventHandler & handler, const char * buffer, const size_t size)
+    {
+        if(buffer == nullptr && size != 0)
+        {
+            throw OperationException(g_ErrorCannotOpenFile);
+        }
+
+        ParseDocument(handler, std::string_view(buffer, size));
     }
 
 
@@ -2285,61 +2446,159 @@ namespace Yaml
 
 
     // Serialization functions
-    void Serialize(const Node & root, const char * filename, const SerializeConfig & config)
+
+    /**
+    * @breif Output of serialization. Text is appended to a growable buffer, and handed
+    *        to the sink in large chunks if there is one, else left in the buffer.
+    *
+    */
+    class SerializeOutput
     {
-        std::stringstream stream;
-        Serialize(root, stream, config);
 
-        std::ofstream f(filename);
-        if (f.is_open() == false)
+    public:
+
+        typedef void (*Sink)(void * pContext, const char * data, const size_t size);
+
+        static const size_t FlushSize = 64 * 1024;
+
+        SerializeOutput(std::string & buffer, Sink sink = nullptr, void * pContext = nullptr) :
+            m_Buffer(buffer),
+            m_Sink(sink),
+            m_pContext(pContext)
         {
-            throw OperationException(g_ErrorCannotOpenFile);
         }
 
-        f.write(stream.str().c_str(), stream.str().size());
-        f.close();
-    }
+        void Append(const std::string_view data)
+        {
+            m_Buffer.append(data.data(), data.size());
+            FlushIfFull();
+        }
 
-    size_t LineFolding(const std::string & input, std::vector<std::string> & folded, const size_t maxLength)
-    {
-        folded.clear();
-        if(input.size() == 0)
+        void Append(const char c)
         {
-            return 0;
+            m_Buffer.push_back(c);
         }
 
-        size_t currentPos = 0;
-        size_t lastPos = 0;
-        size_t spacePos = std::string::npos;
-        while(currentPos < input.size())
+        void Append(const size_t count, const char c)
+        {
+            m_Buffer.append(count, c);
+        }
+
+        /**
+        * @breif Append with backslash and quote escaped.
+        *
+        */
+        void AppendEscaped(const std::string_view data)
+        {
+            size_t start = 0;
+            size_t found = data.find_first_of("\\\"");
+            while(found != std::string_view::npos)
+            {
+                m_Buffer.append(data.data() + start, found - start);
+                m_Buffer.push_back('\\');
+                start = found;
+                found = data.find_first_of("\\\"", found + 1);
+            }
+            Append(data.substr(start));
+        }
+
+        void FlushIfFull()
         {
-            currentPos = lastPos + maxLength;
+            if(m_Sink != nullptr && m_Buffer.size() >= FlushSize)
+            {
+                Flush();
+            }
+        }
 
-            if(currentPos < input.size())
+        void Flush()
+        {
+            if(m_Sink != nullptr && m_Buffer.size())
             {
-               spacePos = input.find_first_of(' ', currentPos);
+                m_Sink(m_pContext, m_Buffer.data(), m_Buffer.size());
+                m_Buffer.clear();
             }
+        }
+
+    private:
 
-            if(spacePos == std::string::npos || currentPos >= input.size())
+        std::string &   m_Buffer;
+        Sink            m_Sink;
+        void *          m_pContext;
+
+    };
+
+    static void WriteStream(void * pContext, const char * data, const size_t size)
+    {
+        static_cast<std::ostream*>(pContext)->write(data, size);
+    }
+
+    static void WriteFile(void * pContext, const char * data, size_t size)
+    {
+        const int fd = *static_cast<int*>(pContext);
+        while(size > 0)
+        {
+#ifdef _WIN32
+            const int written = _write(fd, data, static_cast<unsigned int>(std::min<size_t>(size, INT_MAX)));
+#else
+            const ssize_t written = write(fd, data, size);
+#endif
+            if(written < 0)
             {
-                const std::string endLine = input.substr(lastPos);
-                if(endLine.size())
+                if(errno == EINTR)
                 {
-                    folded.push_back(endLine);
+                    continue;
                 }
-
-                return folded.size();
+                throw OperationException(g_ErrorCannotWriteFile);
             }
+            data += written;
+            size -= written;
+        }
+    }
+
+    static void SerializeDocument(const Node & root, SerializeOutput & output, const SerializeConfig & config);
+
+    void Serialize(const Node & root, const char * filename, const SerializeConfig & config)
+    {
+        std::ofstream f(filename);
+        if (f.is_open() == false)
+        {
+            throw OperationException(g_ErrorCannotOpenFile);
+        }
+
+        Serialize(root, f, config);
+        f.close();
+    }
 
-            folded.push_back(input.substr(lastPos, spacePos - lastPos));
+    /**
+    * @breif Calls visit for each line of input folded at the first space
+    *        after maxLength characters, returning the number of lines.
+    *
+    */
+    template<typename Visitor>
+    static size_t LineFolding(const std::string_view input, const size_t maxLength, Visitor && visit)
+    {
+        size_t count = 0;
+        size_t lastPos = 0;
+        while(lastPos < input.size())
+        {
+            const size_t currentPos = lastPos + maxLength;
+            const size_t spacePos = currentPos < input.size() ? input.find(' ', currentPos) : std::string_view::npos;
+
+            if(spacePos == std::string_view::npos)
+            {
+                visit(input.substr(lastPos));
+                return count + 1;
+            }
 
+            visit(input.substr(lastPos, spacePos - lastPos));
+            count++;
             lastPos = spacePos + 1;
         }
 
-        return folded.size();
+        return count;
     }
 
-    static void SerializeLoop(const Node & node, std::iostream & stream, bool useLevel, const size_t level, const SerializeConfig & config)
+    static void SerializeLoop(const Node & node, SerializeOutput & output, bool useLevel, const size_t level, const SerializeConfig & config)
     {
         const size_t indention = config.SpaceIndentation;
 
@@ -2354,15 +2613,16 @@ namespace Yaml
                     {
                         continue;
                     }
-                    stream << std::string(level, ' ') << "- ";
+                    output.Append(level, ' ');
+                    output.Append("- ");
                     useLevel = false;
                     if(value.IsSequence() || (value.IsMap() && config.SequenceMapNewline == true))
                     {
                         useLevel = true;
-                        stream << "\n";
+                        output.Append('\n');
                     }
 
-                    SerializeLoop(value, stream, useLevel, level + 2, config);
+                    SerializeLoop(value, output, useLevel, level + 2, config);
                 }
 
             }
@@ -2380,18 +2640,20 @@ namespace Yaml
 
                     if(useLevel || count > 0)
                     {
-                       stream << std::string(level, ' ');
+                       output.Append(level, ' ');
                     }
 
-                    std::string key = (*it).first;
-                    AddEscapeTokens(key, "\\\"");
+                    const std::string & key = (*it).first;
                     if(ShouldBeCited(key))
                     {
-                        stream << "\"" << key << "\"" << ": ";
+                        output.Append('"');
+                        output.AppendEscaped(key);
+                        output.Append("\": ");
                     }
                     else
                     {
-                        stream << key << ": ";
+                        output.AppendEscaped(key);
+                        output.Append(": ");
                     }
 
 
@@ -2399,10 +2661,10 @@ namespace Yaml
                     if(value.IsScalar() == false || (value.IsScalar() && config.MapScalarNewline))
                     {
                         useLevel = true;
-                        stream << "\n";
+                        output.Append('\n');
                     }
 
-                    SerializeLoop(value, stream, useLevel, level + indention, config);
+                    SerializeLoop(value, output, useLevel, level + indention, config);
 
                     useLevel = true;
                     count++;
@@ -2412,74 +2674,81 @@ namespace Yaml
             break;
             case Node::ScalarType:
             {
-                const std::string value = node.As<std::string>();
+                const std::string_view value = node.AsStringView();
 
                 // Empty scalar
                 if(value.size() == 0)
                 {
-                    stream << "\n";
+                    output.Append('\n');
                     break;
                 }
 
-                // Get lines of scalar.
-                std::string line = "";
-                std::vector<std::string> lines;
-                std::istringstream iss(value);
-                while (iss.eof() == false)
-                {
-                    std::getline(iss, line);
-                    lines.push_back(line);
-                }
-
-                // Block scalar
-                const std::string & lastLine = lines.back();
-                const bool endNewline = lastLine.size() == 0;
-                if(endNewline)
-                {
-                    lines.pop_back();
-                }
+                // Lines of scalar, without the empty one after a final newline.
+                const bool endNewline = value.back() == '\n';
+                const std::string_view lines(value.data(), value.size() - (endNewline ? 1 : 0));
+                const bool multiLine = lines.find('\n') != std::string_view::npos;
 
                 // Literal
-                if(lines.size() > 1)
+                if(multiLine)
                 {
-                    stream << "|";
+                    output.Append('|');
                 }
                 // Folded/plain
                 else
                 {
-                    const std::string frontLine = lines.front();
-                    if(config.ScalarMaxLength == 0 || lines.front().size() <= config.ScalarMaxLength ||
-                       LineFolding(frontLine, lines, config.ScalarMaxLength) == 1)
+                    if(config.ScalarMaxLength == 0 || lines.size() <= config.ScalarMaxLength ||
+                       LineFolding(lines, config.ScalarMaxLength, [](const std::string_view) {}) == 1)
                     {
                         if(useLevel)
                         {
-                             stream << std::string(level, ' ');
+                             output.Append(level, ' ');
                         }
 
                         if(ShouldBeCited(value))
                         {
-                            stream << "\"" << value << "\"\n";
+                            output.Append('"');
+                            output.Append(value);
+                            output.Append("\"\n");
                             break;
                         }
-                        stream << value << "\n";
+                        output.Append(value);
+                        output.Append('\n');
                         break;
                     }
                     else
                     {
-                        stream << ">";
+                        output.Append('>');
                     }
                 }
 
                 if(endNewline == false)
                 {
-                     stream << "-";
+                     output.Append('-');
                 }
-                stream << "\n";
+                output.Append('\n');
 
+                const auto appendLine = [&output, level](const std::string_view line)
+                {
+                    output.Append(level, ' ');
+                    output.Append(line);
+                    output.Append('\n');
+                };
 
-                for(auto it = lines.begin(); it != lines.end(); it++)
+                if(multiLine)
+                {
+                    size_t start = 0;
+                    size_t end = lines.find('\n');
+                    while(end != std::string_view::npos)
+                    {
+                        appendLine(lines.substr(start, end - start));
+                        start = end + 1;
+                        end = lines.find('\n', start);
+                    }
+                    appendLine(lines.substr(start));
+                }
+                else
                 {
-                    stream << std::string(level, ' ') << (*it) << "\n";
+                    LineFolding(lines, config.ScalarMaxLength, appendLine);
                 }
             }
             break;
@@ -2489,34 +2758,56 @@ namespace Yaml
         }
     }
 
-    void Serialize(const Node & root, std::iostream & stream, const SerializeConfig & config)
+    static void SerializeDocument(const Node & root, SerializeOutput & output, const SerializeConfig & config)
     {
         if(config.SpaceIndentation < 2)
         {
             throw OperationException(g_ErrorIndentation);
         }
 
-        SerializeLoop(root, stream, false, 0, config);
+        SerializeLoop(root, output, false, 0, config);
+        output.Flush();
+    }
+
+    void Serialize(const Node & root, std::iostream & stream, const SerializeConfig & config)
+    {
+        Serialize(root, static_cast<std::ostream &>(stream), config);
+    }
+
+    void Serialize(const Node & root, std::ostream & stream, const SerializeConfig & config)
+    {
+        std::string buffer;
+        buffer.reserve(SerializeOutput::FlushSize + 4096);
+        SerializeOutput output(buffer, WriteStream, &stream);
+        SerializeDocument(root, output, config);
     }
 
     void Serialize(const Node & root, std::string & string, const SerializeConfig & config)
     {
-        std::stringstream stream;
-        Serialize(root, stream, config);
-        string = stream.str();
+        string.clear();
+        SerializeOutput output(string);
+        SerializeDocument(root, output, config);
+    }
+
+    void Serialize(const Node & root, int fd, const SerializeConfig & config)
+    {
+        std::string buffer;
+        buffer.reserve(SerializeOutput::FlushSize + 4096);
+        SerializeOutput output(buffer, WriteFile, &fd);
+        SerializeDocument(root, output, config);
     }
 
 
 
     // Static function implementations
-    std::string ExceptionMessage(const std::string & message, ReaderLine & line)
+    std::string ExceptionMessage(const std::string & message, const ReaderLine & line)
     {
-        return message + std::string(" Line ") + std::to_string(line.No) + std::string(": ") + line.Data;
+        return message + std::string(" Line ") + std::to_string(line.No) + std::string(": ") + std::string(line.Data);
     }
 
-    std::string ExceptionMessage(const std::string & message, ReaderLine & line, const size_t errorPos)
+    std::string ExceptionMessage(const std::string & message, const ReaderLine & line, const size_t errorPos)
     {
-        return message + std::string(" Line ") + std::to_string(line.No) + std::string(" column ") + std::to_string(errorPos + 1) + std::string(": ") + line.Data;
+        return message + std::string(" Line ") + std::to_string(line.No) + std::string(" column ") + std::to_string(errorPos + 1) + std::string(": ") + std::string(line.Data);
     }
 
     std::string ExceptionMessage(const std::string & message, const size_t errorLine, const size_t errorPos)
@@ -2524,12 +2815,12 @@ namespace Yaml
         return message + std::string(" Line ") + std::to_string(errorLine) + std::string(" column ") + std::to_string(errorPos);
     }
 
-    std::string ExceptionMessage(const std::string & message, const size_t errorLine, const std::string & data)
+    std::string ExceptionMessage(const std::string & message, const size_t errorLine, const std::string_view data)
     {
-        return message + std::string(" Line ") + std::to_string(errorLine) + std::string(": ") + data;
+        return message + std::string(" Line ") + std::to_string(errorLine) + std::string(": ") + std::string(data);
     }
 
-    bool FindQuote(const std::string & input, size_t & start, size_t & end, size_t searchPos)
+    bool FindQuote(const std::string_view input, size_t & start, size_t & end, size_t searchPos)
     {
         start = end = std::string::npos;
         size_t qPos = searchPos;
@@ -2572,7 +2863,7 @@ namespace Yaml
         return false;
     }
 
-    size_t FindNotCited(const std::string & input, char token, size_t & preQuoteCount)
+    size_t FindNotCited(const std::string_view input, char token, size_t & preQuoteCount)
     {
         preQuoteCount = 0;
         size_t tokenPos = input.find_first_of(token);
@@ -2634,13 +2925,13 @@ namespace Yaml
         return tokenPos;
     }
 
-    size_t FindNotCited(const std::string & input, char token)
+    size_t FindNotCited(const std::string_view input, char token)
     {
         size_t dummy = 0;
         return FindNotCited(input, token, dummy);
     }
 
-    bool ValidateQuote(const std::string & input)
+    bool ValidateQuote(const std::string_view input)
     {
         if(input.size() == 0)
         {
@@ -2703,54 +2994,9 @@ namespace Yaml
         return token == 0;
     }
 
-    void CopyNode(const Node & from, Node & to)
-    {
-        const Node::eType type = from.Type();
-
-        switch(type)
-        {
-        case Node::SequenceType:
-            for(auto it = from.Begin(); it != from.End(); it++)
-            {
-                const Node & currentNode = (*it).second;
-                Node & newNode = to.PushBack();
-                CopyNode(currentNode, newNode);
-            }
-            break;
-        case Node::MapType:
-            for(auto it = from.Begin(); it != from.End(); it++)
-            {
-                const Node & currentNode = (*it).second;
-                Node & newNode = to[(*it).first];
-                CopyNode(currentNode, newNode);
-            }
-            break;
-        case Node::ScalarType:
-            to = from.As<std::string>();
-            break;
-        case Node::None:
-            break;
-        }
-    }
-
-    bool ShouldBeCited(const std::string & key)
-    {
-        return key.find_first_of("\":{}[],&*#?|-<>=!%@") != std::string::npos;
-    }
-
-    void AddEscapeTokens(std::string & input, const std::string & tokens)
+    bool ShouldBeCited(const std::string_view key)
     {
-        for(auto it = tokens.begin(); it != tokens.end(); it++)
-        {
-            const char token = *it;
-            const std::string replace = std::string("\\") + std::string(1, token);
-            size_t found = input.find_first_of(token);
-            while(found != std::string::npos)
-            {
-                input.replace(found, 1, replace);
-                found = input.find_first_of(token, found + 2);
-            }
-        }
+        return key.find_first_of("\":{}[],&*#?|-<>=!%@") != std::string_view::npos;
     }
 
     void RemoveAllEscapeTokens(std::string & input)
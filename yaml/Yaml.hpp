@@ -33,10 +33,15 @@ https://www.codeproject.com/Articles/28720/YAML-Parser-in-C
 
 #include <exception>
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <limits>
 #include <map>
+#include <type_traits>
 
 /**
 * @breif Namespace wrapping mini-yaml classes.
@@ -59,26 +64,90 @@ namespace Yaml
     namespace impl
     {
 
+        /**
+        * @breif Numeric types converted with std::from_chars.
+        *        Character types are read as characters, like stream extraction does.
+        *
+        */
+        template<typename T>
+        struct IsNumber : std::integral_constant<bool,
+            std::is_arithmetic<T>::value &&
+            !std::is_same<T, bool>::value &&
+            !std::is_same<T, char>::value &&
+            !std::is_same<T, signed char>::value &&
+            !std::is_same<T, unsigned char>::value>
+        {
+        };
+
+        /**
+        * @breif Parse number from start of data.
+        *        Like stream extraction, leading white space and a plus sign are skipped
+        *        and trailing characters are ignored. Out of range values fail.
+        *
+        */
+        template<typename T>
+        bool ParseNumber(std::string_view data, T & value)
+        {
+            const size_t start = data.find_first_not_of(" \t\n\r\f\v");
+            if(start == std::string_view::npos)
+            {
+                return false;
+            }
+            data.remove_prefix(start);
+            if(data.size() > 1 && data[0] == '+' && data[1] != '-')
+            {
+                data.remove_prefix(1);
+            }
+
+            const std::from_chars_result result = std::from_chars(data.data(), data.data() + data.size(), value);
+            return result.ec == std::errc();
+        }
+
+        /**
+        * @breif Parse bool: true, yes and 1 in any case are true, everything else false.
+        *
+        */
+        inline bool ParseBool(const std::string_view data)
+        {
+            const auto equals = [data](const std::string_view word)
+            {
+                if(data.size() != word.size())
+                {
+                    return false;
+                }
+                for(size_t i = 0; i < data.size(); i++)
+                {
+                    if(std::tolower(static_cast<unsigned char>(data[i])) != word[i])
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            };
+
+            return equals("true") || equals("yes") || equals("1");
+        }
+
         /**
         * @breif Helper functionality, converting string to any data type.
         *        Strings are left untouched.
         *
         */
-        template<typename T>
+        template<typename T, typename Enable = void>
         struct StringConverter
         {
-            static T Get(const std::string & data)
+            static T Get(const std::string_view data)
             {
                 T type;
-                std::stringstream ss(data);
+                std::stringstream ss{std::string(data)};
                 ss >> type;
                 return type;
             }
 
-            static T Get(const std::string & data, const T & defaultValue)
+            static T Get(const std::string_view data, const T & defaultValue)
             {
                 T type;
-                std::stringstream ss(data);
+                std::stringstream ss{std::string(data)};
                 ss >> type;
 
                 if(ss.fail())
@@ -89,40 +158,50 @@ namespace Yaml
                 return type;
             }
         };
+
+        template<typename T>
+        struct StringConverter<T, typename std::enable_if<IsNumber<T>::value>::type>
+        {
+            static T Get(const std::string_view data)
+            {
+                T type{};
+                return ParseNumber(data, type) ? type : T();
+            }
+
+            static T Get(const std::string_view data, const T & defaultValue)
+            {
+                T type{};
+                return ParseNumber(data, type) ? type : defaultValue;
+            }
+        };
+
         template<>
         struct StringConverter<std::string>
         {
-            static std::string Get(const std::string & data)
+            static std::string Get(const std::string_view data)
             {
-                return data;
+                return std::string(data);
             }
 
-            static std::string Get(const std::string & data, const std::string & defaultValue)
+            static std::string Get(const std::string_view data, const std::string & defaultValue)
             {
                 if(data.size() == 0)
                 {
                     return defaultValue;
                 }
-                return data;
+                return std::string(data);
             }
         };
 
         template<>
         struct StringConverter<bool>
         {
-            static bool Get(const std::string & data)
+            static bool Get(const std::string_view data)
             {
-                std::string tmpData = data;
-                std::transform(tmpData.begin(), tmpData.end(), tmpData.begin(), ::tolower);
-                if(tmpData == "true" || tmpData == "yes" || tmpData == "1")
-                {
-                    return true;
-                }
-
-                return false;
+                return ParseBool(data);
             }
 
-            static bool Get(const std::string & data, const bool & defaultValue)
+            static bool Get(const std::string_view data, const bool & defaultValue)
             {
                 if(data.size() == 0)
                 {
@@ -133,6 +212,103 @@ namespace Yaml
             }
         };
 
+        /**
+        * @breif Types whose conversion is cached per scalar node, in one of the
+        *        canonical types long long, unsigned long long, double and bool.
+        *
+        */
+        enum class CacheKind : unsigned char
+        {
+            None,
+            Signed,
+            Unsigned,
+            Float,
+            Bool
+        };
+
+        template<typename T>
+        constexpr CacheKind CacheKindOf()
+        {
+            if constexpr (std::is_same<T, bool>::value)
+            {
+                return CacheKind::Bool;
+            }
+            else if constexpr (IsNumber<T>::value && std::is_integral<T>::value && std::is_signed<T>::value)
+            {
+                return CacheKind::Signed;
+            }
+            else if constexpr (IsNumber<T>::value && std::is_integral<T>::value)
+            {
+                return CacheKind::Unsigned;
+            }
+            else if constexpr (std::is_same<T, float>::value || std::is_same<T, double>::value)
+            {
+                return CacheKind::Float;
+            }
+            else
+            {
+                return CacheKind::None;
+            }
+        }
+
+        /**
+        * @breif Cached conversion result.
+        *
+        */
+        struct CachedValue
+        {
+            CacheKind Kind = CacheKind::None;   ///< Kind of value, None if nothing cached.
+            bool Valid = false;                 ///< Conversion succeeded.
+            union
+            {
+                long long           Signed;
+                unsigned long long  Unsigned;
+                double              Float;
+                bool                Bool;
+            };
+        };
+
+        /**
+        * @breif Narrow cached value to T, failing if it is out of range for T.
+        *
+        */
+        template<typename T>
+        bool FromCached(const CachedValue & cached, T & value)
+        {
+            if constexpr (CacheKindOf<T>() == CacheKind::Bool)
+            {
+                value = cached.Bool;
+                return true;
+            }
+            else if constexpr (CacheKindOf<T>() == CacheKind::Float)
+            {
+                if(cached.Float > std::numeric_limits<T>::max() || cached.Float < std::numeric_limits<T>::lowest())
+                {
+                    return false;
+                }
+                value = static_cast<T>(cached.Float);
+                return true;
+            }
+            else if constexpr (CacheKindOf<T>() == CacheKind::Signed)
+            {
+                if(cached.Signed < std::numeric_limits<T>::min() || cached.Signed > std::numeric_limits<T>::max())
+                {
+                    return false;
+                }
+                value = static_cast<T>(cached.Signed);
+                return true;
+            }
+            else
+            {
+                if(cached.Unsigned > std::numeric_limits<T>::max())
+                {
+                    return false;
+                }
+                value = static_cast<T>(cached.Unsigned);
+                return true;
+            }
+        }
+
     }
 
 
@@ -250,8 +426,48 @@ namespace Yaml
     };
 
 
+    /**
+    * @breif Arena allocator for whole documents.
+    *        Nodes constructed with an arena allocate their items and values from it.
+    *        Releasing them is a no-op; the memory is returned at once when the arena is destroyed.
+    *        The arena must outlive its nodes, and is not thread safe.
+    *
+    */
+    class Arena
+    {
+
+    public:
+
+        /**
+        * @breif Constructor.
+        *
+        * @param blockSize  Initial size of allocated blocks. Later blocks grow geometrically.
+        *
+        */
+        explicit Arena(const size_t blockSize = 64 * 1024);
+
+        /**
+        * @breif Destructor. Releases all memory of nodes allocated from the arena.
+        *
+        */
+        ~Arena();
+
+        Arena(const Arena &) = delete;
+        Arena & operator = (const Arena &) = delete;
+
+    private:
+
+        friend struct ArenaAccess;
+
+        void * m_pImp; ///< Implementation of arena class.
+
+    };
+
+
     /**
     * @breif Iterator class.
+    *        Iterators are plain indexes into their node and never allocate.
+    *        Modifying the node invalidates them.
     *
     */
     class Iterator
@@ -325,8 +541,9 @@ namespace Yaml
             MapType
         };
 
-        eType   m_Type; ///< Type of iterator.
-        void *  m_pImp; ///< Implementation of iterator class.
+        eType   m_Type;     ///< Type of iterator.
+        void *  m_pImp;     ///< Iterated sequence or map implementation.
+        size_t  m_Index;    ///< Current item index.
 
     };
 
@@ -406,8 +623,9 @@ namespace Yaml
             MapType
         };
 
-        eType   m_Type; ///< Type of iterator.
-        void *  m_pImp; ///< Implementation of constant iterator class.
+        eType   m_Type;     ///< Type of iterator.
+        void *  m_pImp;     ///< Iterated sequence or map implementation.
+        size_t  m_Index;    ///< Current item index.
 
     };
 
@@ -422,6 +640,7 @@ namespace Yaml
     public:
 
         friend class Iterator;
+        friend class TreeBuilder;
 
         /**
         * @breif Enumeration of node types.
@@ -447,6 +666,19 @@ namespace Yaml
         */
         Node(const Node & node);
 
+        /**
+        * @breif Arena constructor.
+        *        Node and all of its items are allocated from arena, which must outlive the node.
+        *
+        */
+        explicit Node(Arena & arena);
+
+        /**
+        * @breif Move constructor. The new node uses the arena of node.
+        *
+        */
+        Node(Node && node) noexcept;
+
         /**
         * @breif Assignment constructors.
         *        Converts node to scalar type if needed.
@@ -484,7 +716,15 @@ namespace Yaml
         template<typename T>
         T As() const
         {
-            return impl::StringConverter<T>::Get(AsString());
+            if constexpr (impl::CacheKindOf<T>() != impl::CacheKind::None)
+            {
+                T value{};
+                return GetCached(value) ? value : T();
+            }
+            else
+            {
+                return impl::StringConverter<T>::Get(AsStringView());
+            }
         }
 
         /**
@@ -494,9 +734,24 @@ namespace Yaml
         template<typename T>
         T As(const T & defaultValue) const
         {
-            return impl::StringConverter<T>::Get(AsString(), defaultValue);
+            if constexpr (impl::CacheKindOf<T>() != impl::CacheKind::None)
+            {
+                T value{};
+                return AsStringView().size() && GetCached(value) ? value : defaultValue;
+            }
+            else
+            {
+                return impl::StringConverter<T>::Get(AsStringView(), defaultValue);
+            }
         }
 
+        /**
+        * @breif Get view of scalar data, empty if node is not a scalar.
+        *        The view is valid until the node is modified or destroyed.
+        *
+        */
+        std::string_view AsStringView() const;
+
         /**
         * @breif Get size of node.
         *        Nodes of type None or Scalar will return 0.
@@ -504,6 +759,13 @@ namespace Yaml
         */
         size_t Size() const;
 
+        /**
+        * @breif Get line number the node was parsed from, starting at 1.
+        *        Returns 0 if the node was not parsed.
+        *
+        */
+        size_t Line() const;
+
         // Sequence operators
 
         /**
@@ -537,7 +799,7 @@ namespace Yaml
         *
         */
         Node & operator []  (const size_t index);
-        Node & operator [] (const std::string & key);
+        Node & operator [] (const std::string_view key);
 
         /**
         * @breif Erase item.
@@ -545,7 +807,7 @@ namespace Yaml
         *
         */
         void Erase(const size_t index);
-        void Erase(const std::string & key);
+        void Erase(const std::string_view key);
 
         /**
         * @breif Assignment operators.
@@ -553,8 +815,16 @@ namespace Yaml
         */
         Node & operator = (const Node & node);
         Node & operator = (const std::string & value);
+        Node & operator = (const std::string_view value);
         Node & operator = (const char * value);
 
+        /**
+        * @breif Move assignment operator.
+        *        Takes over the data of node if both use the same arena, else copies it.
+        *
+        */
+        Node & operator = (Node && node) noexcept;
+
         /**
         * @breif Get start iterator.
         *
@@ -573,12 +843,34 @@ namespace Yaml
     private:
 
         /**
-        * @breif Get as string. If type is scalar, else empty.
+        * @breif Get number or bool conversion of scalar, using the cached result of
+        *        an earlier conversion if it is of the same kind. Returns false if the
+        *        conversion fails.
+        *
+        */
+        template<typename T>
+        bool GetCached(T & value) const
+        {
+            const impl::CachedValue * pCached = Convert(impl::CacheKindOf<T>());
+            return pCached != nullptr && pCached->Valid && impl::FromCached(*pCached, value);
+        }
+
+        /**
+        * @breif Get conversion of given kind, converting and caching it if needed.
+        *        Returns nullptr if node is not a scalar.
         *
         */
-        const std::string & AsString() const;
+        const impl::CachedValue * Convert(const impl::CacheKind kind) const;
 
-        void * m_pImp; ///< Implementation of node class.
+        /**
+        * @breif Deep copy node into this, which must be of type None.
+        *
+        */
+        void CopyFrom(const Node & node);
+
+        void *  m_pImp;     ///< Implementation of node type, nullptr if None.
+        Arena * m_pArena;   ///< Arena allocating this node's data, nullptr for the heap.
+        size_t  m_Line;     ///< Line number in parsed input, 0 if unknown.
 
     };
 
@@ -605,6 +897,65 @@ namespace Yaml
     void Parse(Node & root, const char * buffer, const size_t size);
 
 
+    /**
+    * @breif    Receiver of streaming parse events.
+    *           Lets large documents be consumed without building a Node tree;
+    *           the parser holds only what its current nesting depth needs.
+    *           Every map value is preceded by its Key. A value is a Scalar, a
+    *           nested map or sequence, or Null for an empty block scalar.
+    *           Views passed to callbacks are valid for the duration of the call.
+    *
+    */
+    class EventHandler
+    {
+
+    public:
+
+        virtual ~EventHandler() = default;
+
+        virtual void StartMap() {}
+        virtual void EndMap() {}
+        virtual void StartSequence() {}
+        virtual void EndSequence() {}
+        virtual void Key(const std::string_view /*key*/) {}
+        virtual void Scalar(const std::string_view /*value*/) {}
+        virtual void Null() {}
+
+        /**
+        * @breif Get line number of the event being delivered, starting at 1.
+        *
+        */
+        size_t Line() const
+        {
+            return m_Line;
+        }
+
+    private:
+
+        friend class ParseImp;
+
+        size_t m_Line = 0; ///< Line of current event.
+
+    };
+
+
+    /**
+    * @breif Streaming parsing functions, accepting the same documents as above.
+    *        Events already delivered stay delivered if a later error throws.
+    *
+    * @param handler    Receiver of parse events.
+    *
+    * @throw InternalException  An internal error occurred.
+    * @throw ParsingException   Invalid input YAML data.
+    * @throw OperationException If filename or buffer pointer is invalid.
+    *
+    */
+    void Parse(EventHandler & handler, const char * filename);
+    void Parse(EventHandler & handler, std::iostream & stream);
+    void Parse(EventHandler & handler, const std::string & string);
+    void Parse(EventHandler & handler, const char * buffer, const size_t size);
+
+
     /**
     * @breif    Serialization configuration structure,
     *           describing output behavior.
@@ -636,21 +987,27 @@ namespace Yaml
 
 
     /**
-    * @breif Serialization functions.
+    * @breif    Serialization functions.
+    *           Output is built in a growable buffer. Files, streams and descriptors
+    *           receive it in 64 KiB chunks; a string receives it directly, reusing its capacity.
     *
     * @param root       Root node to serialize.
     * @param filename   Path of output file.
     * @param stream     Output stream.
-    * @param string     String of output data.
+    * @param string     String of output data. Previous contents are replaced.
+    * @param fd         Open file descriptor, written to with write().
     * @param config     Serialization configurations.
     *
     * @throw InternalException  An internal error occurred.
     * @throw OperationException If filename or buffer pointer is invalid.
     *                           If config is invalid.
+    *                           If writing to fd fails.
     *
     */
     void Serialize(const Node & root, const char * filename, const SerializeConfig & config = {2, 64, false, false});
     void Serialize(const Node & root, std::iostream & stream, const SerializeConfig & config = {2, 64, false, false});
+    void Serialize(const Node & root, std::ostream & stream, const SerializeConfig & config = {2, 64, false, false});
     void Serialize(const Node & root, std::string & string, const SerializeConfig & config = {2, 64, false, false});
+    void Serialize(const Node & root, int fd, const SerializeConfig & config = {2, 64, false, false});
 
 }
\ No newline at end of file